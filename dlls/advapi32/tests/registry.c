@@ -4542,6 +4542,97 @@ static void test_RegRenameKey(void)
     RegCloseKey(key);
 }
 
+static void test_many_subkeys(void)
+{
+    char name[32], buffer[32];
+    DWORD ret, count, size;
+    HKEY key, subkey;
+    int i;
+
+    ret = RegCreateKeyA(hkey_main, "ManySubkeys", &key);
+    ok(!ret, "RegCreateKeyA failed, got %ld\n", ret);
+
+    /* create them in reverse order, so that every insertion shifts the existing subkeys */
+    for (i = 99; i >= 0; i--)
+    {
+        sprintf(name, "subkey%03d", i);
+        ret = RegCreateKeyA(key, name, &subkey);
+        ok(!ret, "RegCreateKeyA %s failed, got %ld\n", name, ret);
+        RegCloseKey(subkey);
+    }
+
+    ret = RegQueryInfoKeyA(key, NULL, NULL, NULL, &count, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+    ok(!ret, "RegQueryInfoKeyA failed, got %ld\n", ret);
+    ok(count == 100, "got %lu subkeys\n", count);
+
+    for (i = 0; i < 100; i++)
+    {
+        sprintf(name, "SUBKEY%03d", i);
+        ret = RegOpenKeyA(key, name, &subkey);
+        ok(!ret, "RegOpenKeyA %s failed, got %ld\n", name, ret);
+        RegCloseKey(subkey);
+
+        sprintf(name, "subkey%03d", i);
+        size = sizeof(buffer);
+        ret = RegEnumKeyExA(key, i, buffer, &size, NULL, NULL, NULL, NULL);
+        ok(!ret, "RegEnumKeyExA %d failed, got %ld\n", i, ret);
+        ok(!strcmp(buffer, name), "got %s, expected %s\n", buffer, name);
+    }
+    ret = RegOpenKeyA(key, "subkey100", &subkey);
+    ok(ret == ERROR_FILE_NOT_FOUND, "RegOpenKeyA succeeded, got %ld\n", ret);
+
+    /* re-creating an existing subkey must not add a duplicate */
+    ret = RegCreateKeyA(key, "Subkey050", &subkey);
+    ok(!ret, "RegCreateKeyA failed, got %ld\n", ret);
+    RegCloseKey(subkey);
+    ret = RegQueryInfoKeyA(key, NULL, NULL, NULL, &count, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+    ok(!ret, "RegQueryInfoKeyA failed, got %ld\n", ret);
+    ok(count == 100, "got %lu subkeys\n", count);
+
+    ret = RegRenameKey(key, L"subkey050", L"renamed");
+    ok(!ret, "RegRenameKey failed, got %ld\n", ret);
+    ret = RegOpenKeyA(key, "subkey050", &subkey);
+    ok(ret == ERROR_FILE_NOT_FOUND, "RegOpenKeyA succeeded, got %ld\n", ret);
+    ret = RegOpenKeyA(key, "Renamed", &subkey);
+    ok(!ret, "RegOpenKeyA failed, got %ld\n", ret);
+    RegCloseKey(subkey);
+    ret = RegDeleteKeyA(key, "renamed");
+    ok(!ret, "RegDeleteKeyA failed, got %ld\n", ret);
+
+    for (i = 0; i < 100; i += 2)
+    {
+        if (i == 50) continue;
+        sprintf(name, "subkey%03d", i);
+        ret = RegDeleteKeyA(key, name);
+        ok(!ret, "RegDeleteKeyA %s failed, got %ld\n", name, ret);
+    }
+    for (i = 0; i < 100; i++)
+    {
+        sprintf(name, "subkey%03d", i);
+        ret = RegOpenKeyA(key, name, &subkey);
+        if (i % 2)
+        {
+            ok(!ret, "RegOpenKeyA %s failed, got %ld\n", name, ret);
+            RegCloseKey(subkey);
+        }
+        else ok(ret == ERROR_FILE_NOT_FOUND, "RegOpenKeyA %s succeeded, got %ld\n", name, ret);
+    }
+
+    for (i = 1; i < 100; i += 2)
+    {
+        sprintf(name, "subkey%03d", i);
+        ret = RegDeleteKeyA(key, name);
+        ok(!ret, "RegDeleteKeyA %s failed, got %ld\n", name, ret);
+    }
+    ret = RegQueryInfoKeyA(key, NULL, NULL, NULL, &count, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+    ok(!ret, "RegQueryInfoKeyA failed, got %ld\n", ret);
+    ok(!count, "got %lu subkeys\n", count);
+
+    ret = RegDeleteKeyA(key, "");
+    ok(!ret, "RegDeleteKeyA failed, got %ld\n", ret);
+    RegCloseKey(key);
+}
+
 START_TEST(registry)
 {
     /* Load pointers for functions that are not available in all Windows versions */
@@ -4583,6 +4674,7 @@ START_TEST(registry)
     test_EnumDynamicTimeZoneInformation();
     test_perflib_key();
     test_RegRenameKey();
+    test_many_subkeys();
 
     /* cleanup */
     delete_key( hkey_main );
@@ -1939,11 +1939,102 @@ static struct block *find_free_bin_block( struct heap *heap, ULONG flags, SIZE_T
     return block;
 }
 
+/* per-thread cache of free LFH blocks from the process heap, so that a thread freeing and
+ * allocating blocks of the same size doesn't need to touch the shared group state */
+
+#define THREAD_CACHE_BIN_COUNT  0x30  /* only the smallest bins are cached */
+#define THREAD_CACHE_DEPTH      16    /* max number of cached blocks per bin */
+
+struct thread_cache
+{
+    struct block *blocks[THREAD_CACHE_BIN_COUNT][THREAD_CACHE_DEPTH];
+    BYTE          count[THREAD_CACHE_BIN_COUNT];
+    ULONG         hits;
+    ULONG         misses;
+};
+
+#define THREAD_CACHE_DISABLED ((struct thread_cache *)~(UINT_PTR)0)
+
+/* the cache pointer is kept in an otherwise unused TEB field */
+static inline struct thread_cache **thread_cache_ptr(void)
+{
+    return (struct thread_cache **)&NtCurrentTeb()->Reserved5[1];
+}
+
+static struct thread_cache *get_thread_cache( BOOL create )
+{
+    struct thread_cache *cache = *thread_cache_ptr();
+    SIZE_T size = sizeof(*cache);
+    void *addr = NULL;
+
+    if (cache == THREAD_CACHE_DISABLED) return NULL;
+    if (cache || !create) return cache;
+
+    if (NtAllocateVirtualMemory( NtCurrentProcess(), &addr, 0, &size, MEM_COMMIT, PAGE_READWRITE ))
+        return NULL;
+    return *thread_cache_ptr() = addr;
+}
+
+static struct block *thread_cache_pop( SIZE_T bin )
+{
+    struct thread_cache *cache;
+
+    if (bin >= THREAD_CACHE_BIN_COUNT || !(cache = get_thread_cache( FALSE ))) return NULL;
+    if (!cache->count[bin])
+    {
+        cache->misses++;
+        return NULL;
+    }
+    cache->hits++;
+    return cache->blocks[bin][--cache->count[bin]];
+}
+
+static NTSTATUS group_free_block( struct heap *heap, ULONG flags, struct bin *bin, struct block *block );
+
+/* flush the oldest half of a bin cache back to the groups */
+static void thread_cache_flush_bin( struct heap *heap, ULONG flags, struct thread_cache *cache, SIZE_T bin )
+{
+    UINT i, count = (cache->count[bin] + 1) / 2;
+
+    for (i = 0; i < count; i++) group_free_block( heap, flags, heap->bins + bin, cache->blocks[bin][i] );
+    memmove( cache->blocks[bin], cache->blocks[bin] + count, (cache->count[bin] - count) * sizeof(struct block *) );
+    cache->count[bin] -= count;
+}
+
+static BOOL thread_cache_push( struct heap *heap, ULONG flags, SIZE_T bin, struct block *block )
+{
+    struct thread_cache *cache;
+
+    if (bin >= THREAD_CACHE_BIN_COUNT || !(cache = get_thread_cache( TRUE ))) return FALSE;
+    if (cache->count[bin] == THREAD_CACHE_DEPTH) thread_cache_flush_bin( heap, flags, cache, bin );
+    cache->blocks[bin][cache->count[bin]++] = block;
+    return TRUE;
+}
+
+/* return all the cached blocks to the groups and disable the cache for the exiting thread */
+static void heap_thread_detach_cache( struct heap *heap )
+{
+    struct thread_cache *cache = get_thread_cache( FALSE );
+    SIZE_T bin, size = 0;
+    void *addr = cache;
+    UINT i;
+
+    *thread_cache_ptr() = THREAD_CACHE_DISABLED;
+    if (!cache) return;
+
+    TRACE( "thread cache hits %lu, misses %lu\n", cache->hits, cache->misses );
+    for (bin = 0; bin < THREAD_CACHE_BIN_COUNT; bin++)
+        for (i = 0; i < cache->count[bin]; i++)
+            group_free_block( heap, heap->flags, heap->bins + bin, cache->blocks[bin][i] );
+
+    NtFreeVirtualMemory( NtCurrentProcess(), &addr, &size, MEM_RELEASE );
+}
+
 static NTSTATUS heap_allocate_block_lfh( struct heap *heap, ULONG flags, SIZE_T block_size,
                                          SIZE_T size, void **ret )
 {
     struct bin *bin, *last = heap->bins + BLOCK_SIZE_BIN_COUNT - 1;
-    struct block *block;
+    struct block *block = NULL;
 
     bin = heap->bins + BLOCK_SIZE_BIN( block_size );
     if (bin == last) return STATUS_UNSUCCESSFUL;
@@ -1953,7 +2044,8 @@ static NTSTATUS heap_allocate_block_lfh( struct heap *heap, ULONG flags, SIZE_T
 
     block_size = BLOCK_BIN_SIZE( BLOCK_SIZE_BIN( block_size ) );
 
-    if ((block = find_free_bin_block( heap, flags, block_size, bin )))
+    if (heap == process_heap) block = thread_cache_pop( bin - heap->bins );
+    if (block || (block = find_free_bin_block( heap, flags, block_size, bin )))
     {
         block_set_type( block, BLOCK_TYPE_USED );
         block_set_flags( block, (BYTE)~BLOCK_FLAG_LFH, BLOCK_USER_FLAGS( flags ) );
@@ -1966,33 +2058,42 @@ static NTSTATUS heap_allocate_block_lfh( struct heap *heap, ULONG flags, SIZE_T
     return block ? STATUS_SUCCESS : STATUS_NO_MEMORY;
 }
 
-static NTSTATUS heap_free_block_lfh( struct heap *heap, ULONG flags, struct block *block )
+/* return a free block to its group, the group is released if it was the last used block */
+static NTSTATUS group_free_block( struct heap *heap, ULONG flags, struct bin *bin, struct block *block )
 {
-    struct bin *bin, *last = heap->bins + BLOCK_SIZE_BIN_COUNT - 1;
-    SIZE_T i, block_size = block_get_size( block );
     struct group *group = block_get_group( block );
+    SIZE_T i = block_get_group_index( block );
     NTSTATUS status = STATUS_SUCCESS;
 
+    /* if this was the last used block in a group and GROUP_FLAG_FREE was set */
+    if (InterlockedOr( &group->free_bits, 1 << i ) == ~(1 << i))
+    {
+        /* thread now owns the group, and can release it to its bin */
+        group->free_bits = ~GROUP_FLAG_FREE;
+        status = heap_release_bin_group( heap, flags, bin, group );
+    }
+
+    return status;
+}
+
+static NTSTATUS heap_free_block_lfh( struct heap *heap, ULONG flags, struct block *block )
+{
+    struct bin *bin, *last = heap->bins + BLOCK_SIZE_BIN_COUNT - 1;
+    SIZE_T block_size = block_get_size( block );
+
     if (!(block_get_flags( block ) & BLOCK_FLAG_LFH)) return STATUS_UNSUCCESSFUL;
 
     bin = heap->bins + BLOCK_SIZE_BIN( block_size );
     if (bin == last) return STATUS_UNSUCCESSFUL;
 
-    i = block_get_group_index( block );
     valgrind_make_writable( block, sizeof(*block) );
     block_set_type( block, BLOCK_TYPE_FREE );
     block_set_flags( block, (BYTE)~BLOCK_FLAG_LFH, BLOCK_FLAG_FREE );
     mark_block_free( block + 1, (char *)block + block_size - (char *)(block + 1), flags );
 
-    /* if this was the last used block in a group and GROUP_FLAG_FREE was set */
-    if (InterlockedOr( &group->free_bits, 1 << i ) == ~(1 << i))
-    {
-        /* thread now owns the group, and can release it to its bin */
-        group->free_bits = ~GROUP_FLAG_FREE;
-        status = heap_release_bin_group( heap, flags, bin, group );
-    }
-
-    return status;
+    if (heap == process_heap && thread_cache_push( heap, flags, bin - heap->bins, block ))
+        return STATUS_SUCCESS;
+    return group_free_block( heap, flags, bin, block );
 }
 
 static void bin_try_enable( struct heap *heap, struct bin *bin )
@@ -2048,6 +2149,7 @@ void heap_thread_detach(void)
     LIST_FOR_EACH_ENTRY( heap, &process_heap->entry, struct heap, entry )
         heap_thread_detach_bin_groups( heap );
 
+    heap_thread_detach_cache( process_heap );
     heap_thread_detach_bin_groups( process_heap );
 
     RtlLeaveCriticalSection( &process_heap->cs );
@@ -984,9 +984,9 @@ static void WINAPI user_apc_proc(ULONG_PTR arg)
 
 static void test_set_io_completion(void)
 {
-    FILE_IO_COMPLETION_INFORMATION info[2] = {{0}};
+    FILE_IO_COMPLETION_INFORMATION info[2] = {{0}}, many_info[100];
     LARGE_INTEGER timeout = {{0}};
-    unsigned int apc_count;
+    unsigned int apc_count, i;
     IO_STATUS_BLOCK iosb;
     ULONG_PTR key, value;
     NTSTATUS res;
@@ -1065,6 +1065,29 @@ static void test_set_io_completion(void)
         info[1].IoStatusBlock.Information );
     ok( U(info[1].IoStatusBlock).Status == 56, "wrong status %#lx\n", U(info[1].IoStatusBlock).Status);
 
+    for (i = 0; i < ARRAY_SIZE(many_info); i++)
+    {
+        res = pNtSetIoCompletion( h, i, 456, 789, size );
+        ok( res == STATUS_SUCCESS, "NtSetIoCompletion failed: %#lx\n", res );
+    }
+
+    count = 0xdeadbeef;
+    res = pNtRemoveIoCompletionEx( h, many_info, 90, &count, &timeout, FALSE );
+    ok( res == STATUS_SUCCESS, "NtRemoveIoCompletionEx failed: %#lx\n", res );
+    ok( count == 90, "wrong count %lu\n", count );
+    for (i = 0; i < count; i++)
+        ok( many_info[i].CompletionKey == i, "%u: wrong key %#Ix\n", i, many_info[i].CompletionKey );
+
+    count = get_pending_msgs(h);
+    ok( count == 10, "Unexpected msg count: %ld\n", count );
+
+    count = 0xdeadbeef;
+    res = pNtRemoveIoCompletionEx( h, many_info, ARRAY_SIZE(many_info), &count, &timeout, FALSE );
+    ok( res == STATUS_SUCCESS, "NtRemoveIoCompletionEx failed: %#lx\n", res );
+    ok( count == 10, "wrong count %lu\n", count );
+    for (i = 0; i < count; i++)
+        ok( many_info[i].CompletionKey == 90 + i, "%u: wrong key %#Ix\n", i, many_info[i].CompletionKey );
+
     res = pNtSetIoCompletion( h, 123, 456, 789, size );
     ok( res == STATUS_SUCCESS, "NtSetIoCompletion failed: %#lx\n", res );
 
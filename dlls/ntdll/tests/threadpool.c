@@ -690,6 +690,11 @@ static void CALLBACK work_cb(TP_CALLBACK_INSTANCE *instance, void *userdata, TP_
     InterlockedIncrement((LONG *)userdata);
 }
 
+static void CALLBACK work_count_cb(TP_CALLBACK_INSTANCE *instance, void *userdata, TP_WORK *work)
+{
+    InterlockedIncrement((LONG *)userdata);
+}
+
 static void CALLBACK work2_cb(TP_CALLBACK_INSTANCE *instance, void *userdata, TP_WORK *work)
 {
     Sleep(100);
@@ -738,6 +743,28 @@ static void test_tp_work(void)
     /* cleanup */
     pTpReleaseWork(work);
     pTpReleasePool(pool);
+
+    /* post many short work items to a pool with several threads */
+    pool = NULL;
+    status = pTpAllocPool(&pool, NULL);
+    ok(!status, "TpAllocPool failed with status %lx\n", status);
+    ok(pool != NULL, "expected pool != NULL\n");
+    pTpSetPoolMaxThreads(pool, 4);
+
+    work = NULL;
+    environment.Pool = pool;
+    status = pTpAllocWork(&work, work_count_cb, &userdata, &environment);
+    ok(!status, "TpAllocWork failed with status %lx\n", status);
+    ok(work != NULL, "expected work != NULL\n");
+
+    userdata = 0;
+    for (i = 0; i < 1000; i++)
+        pTpPostWork(work);
+    pTpWaitForWork(work, FALSE);
+    ok(userdata == 1000, "expected userdata = 1000, got %lu\n", userdata);
+
+    pTpReleaseWork(work);
+    pTpReleasePool(pool);
 }
 
 static void test_tp_work_scheduler(void)
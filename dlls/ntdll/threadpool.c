@@ -1248,7 +1248,8 @@ static void CALLBACK waitqueue_thread_proc( void *param )
     struct waitqueue_bucket *bucket = param;
     struct threadpool_object *wait, *next;
     LARGE_INTEGER now, timeout;
-    DWORD num_handles;
+    DWORD num_handles = 0;
+    BOOL rebuild = TRUE;
     NTSTATUS status;
 
     TRACE( "starting wait queue thread\n" );
@@ -1258,44 +1259,58 @@ static void CALLBACK waitqueue_thread_proc( void *param )
 
     for (;;)
     {
-        NtQuerySystemTime( &now );
-        timeout.QuadPart = MAXLONGLONG;
-        num_handles = 0;
-
-        LIST_FOR_EACH_ENTRY_SAFE( wait, next, &bucket->waiting, struct threadpool_object,
-                                  u.wait.wait_entry )
+        /* The handle array only has to be rebuilt when the set of wait objects
+         * or their timeouts changed, which always signals the update event. */
+        if (rebuild || !bucket->objcount)
         {
-            assert( wait->type == TP_OBJECT_TYPE_WAIT );
-            if (wait->u.wait.timeout <= now.QuadPart)
+            /* Release temporary references to wait objects. */
+            while (num_handles)
             {
-                /* Wait object timed out. */
-                if ((wait->u.wait.flags & WT_EXECUTEONLYONCE))
+                wait = objects[--num_handles];
+                assert( wait->type == TP_OBJECT_TYPE_WAIT );
+                tp_object_release( wait );
+            }
+
+            NtQuerySystemTime( &now );
+            timeout.QuadPart = MAXLONGLONG;
+
+            LIST_FOR_EACH_ENTRY_SAFE( wait, next, &bucket->waiting, struct threadpool_object,
+                                      u.wait.wait_entry )
+            {
+                assert( wait->type == TP_OBJECT_TYPE_WAIT );
+                if (wait->u.wait.timeout <= now.QuadPart)
                 {
-                    list_remove( &wait->u.wait.wait_entry );
-                    list_add_tail( &bucket->reserved, &wait->u.wait.wait_entry );
+                    /* Wait object timed out. */
+                    if ((wait->u.wait.flags & WT_EXECUTEONLYONCE))
+                    {
+                        list_remove( &wait->u.wait.wait_entry );
+                        list_add_tail( &bucket->reserved, &wait->u.wait.wait_entry );
+                    }
+                    if ((wait->u.wait.flags & (WT_EXECUTEINWAITTHREAD | WT_EXECUTEINIOTHREAD)))
+                    {
+                        InterlockedIncrement( &wait->refcount );
+                        wait->num_pending_callbacks++;
+                        RtlEnterCriticalSection( &wait->pool->cs );
+                        tp_object_execute( wait, TRUE );
+                        RtlLeaveCriticalSection( &wait->pool->cs );
+                        tp_object_release( wait );
+                    }
+                    else tp_object_submit( wait, FALSE );
                 }
-                if ((wait->u.wait.flags & (WT_EXECUTEINWAITTHREAD | WT_EXECUTEINIOTHREAD)))
+                else
                 {
+                    if (wait->u.wait.timeout < timeout.QuadPart)
+                        timeout.QuadPart = wait->u.wait.timeout;
+
+                    assert( num_handles < MAXIMUM_WAITQUEUE_OBJECTS );
                     InterlockedIncrement( &wait->refcount );
-                    wait->num_pending_callbacks++;
-                    RtlEnterCriticalSection( &wait->pool->cs );
-                    tp_object_execute( wait, TRUE );
-                    RtlLeaveCriticalSection( &wait->pool->cs );
-                    tp_object_release( wait );
+                    objects[num_handles] = wait;
+                    /* the update event goes first, so that changes are never starved */
+                    handles[num_handles + 1] = wait->u.wait.handle;
+                    num_handles++;
                 }
-                else tp_object_submit( wait, FALSE );
-            }
-            else
-            {
-                if (wait->u.wait.timeout < timeout.QuadPart)
-                    timeout.QuadPart = wait->u.wait.timeout;
-
-                assert( num_handles < MAXIMUM_WAITQUEUE_OBJECTS );
-                InterlockedIncrement( &wait->refcount );
-                objects[num_handles] = wait;
-                handles[num_handles] = wait->u.wait.handle;
-                num_handles++;
             }
+            rebuild = FALSE;
         }
 
         if (!bucket->objcount)
@@ -1310,17 +1325,18 @@ static void CALLBACK waitqueue_thread_proc( void *param )
 
             if (status == STATUS_TIMEOUT && !bucket->objcount)
                 break;
+            rebuild = TRUE;
         }
         else
         {
-            handles[num_handles] = bucket->update_event;
+            handles[0] = bucket->update_event;
             RtlLeaveCriticalSection( &waitqueue.cs );
             status = NtWaitForMultipleObjects( num_handles + 1, handles, TRUE, bucket->alertable, &timeout );
             RtlEnterCriticalSection( &waitqueue.cs );
 
-            if (status >= STATUS_WAIT_0 && status < STATUS_WAIT_0 + num_handles)
+            if (status > STATUS_WAIT_0 && status <= STATUS_WAIT_0 + num_handles)
             {
-                wait = objects[status - STATUS_WAIT_0];
+                wait = objects[status - STATUS_WAIT_0 - 1];
                 assert( wait->type == TP_OBJECT_TYPE_WAIT );
                 if (wait->u.wait.bucket)
                 {
@@ -1330,6 +1346,7 @@ static void CALLBACK waitqueue_thread_proc( void *param )
                     {
                         list_remove( &wait->u.wait.wait_entry );
                         list_add_tail( &bucket->reserved, &wait->u.wait.wait_entry );
+                        rebuild = TRUE;
                     }
                     if ((wait->u.wait.flags & (WT_EXECUTEINWAITTHREAD | WT_EXECUTEINIOTHREAD)))
                     {
@@ -1342,16 +1359,12 @@ static void CALLBACK waitqueue_thread_proc( void *param )
                     else tp_object_submit( wait, TRUE );
                 }
                 else
+                {
                     WARN("wait object %p triggered while object was destroyed\n", wait);
+                    rebuild = TRUE;
+                }
             }
-
-            /* Release temporary references to wait objects. */
-            while (num_handles)
-            {
-                wait = objects[--num_handles];
-                assert( wait->type == TP_OBJECT_TYPE_WAIT );
-                tp_object_release( wait );
-            }
+            else rebuild = TRUE;
         }
 
         /* Try to merge bucket with other threads. */
@@ -1389,6 +1402,7 @@ static void CALLBACK waitqueue_thread_proc( void *param )
                     list_add_tail( &waitqueue.buckets, &bucket->bucket_entry );
 
                     NtSetEvent( other_bucket->update_event, NULL );
+                    rebuild = TRUE;
                     break;
                 }
             }
@@ -1984,16 +1998,23 @@ static void tp_object_submit( struct threadpool_object *object, BOOL signaled )
 {
     struct threadpool *pool = object->pool;
     NTSTATUS status = STATUS_UNSUCCESSFUL;
+    BOOL new_worker = FALSE;
+    HANDLE thread;
 
     assert( !object->shutdown );
     assert( !pool->shutdown );
 
     RtlEnterCriticalSection( &pool->cs );
 
-    /* Start new worker threads if required. */
+    /* Account a new worker thread if required. The thread itself is created
+     * after leaving the critical section, creating it involves a server call. */
     if (pool->num_busy_workers >= pool->num_workers &&
         pool->num_workers < pool->max_workers)
-        status = tp_new_worker_thread( pool );
+    {
+        InterlockedIncrement( &pool->refcount );
+        pool->num_workers++;
+        new_worker = TRUE;
+    }
 
     /* Queue work item and increment refcount. */
     InterlockedIncrement( &object->refcount );
@@ -2004,14 +2025,28 @@ static void tp_object_submit( struct threadpool_object *object, BOOL signaled )
     if (object->type == TP_OBJECT_TYPE_WAIT && signaled)
         object->u.wait.signaled++;
 
-    /* No new thread started - wake up one existing thread. */
-    if (status != STATUS_SUCCESS)
+    RtlLeaveCriticalSection( &pool->cs );
+
+    if (new_worker)
     {
+        status = RtlCreateUserThread( GetCurrentProcess(), NULL, FALSE, 0, 0, 0,
+                                      threadpool_worker_proc, pool, &thread, NULL );
+        if (status == STATUS_SUCCESS)
+        {
+            NtClose( thread );
+            return;
+        }
+
+        RtlEnterCriticalSection( &pool->cs );
+        pool->num_workers--;
         assert( pool->num_workers > 0 );
-        RtlWakeConditionVariable( &pool->update_event );
+        RtlLeaveCriticalSection( &pool->cs );
+        tp_threadpool_release( pool );
     }
 
-    RtlLeaveCriticalSection( &pool->cs );
+    /* No new thread started - wake up one existing thread. Waking after the
+     * critical section was left avoids the woken thread blocking on it. */
+    RtlWakeConditionVariable( &pool->update_event );
 }
 
 /***********************************************************************
@@ -2735,6 +2735,236 @@ NTSTATUS WINAPI NtQueryDirectoryFile( HANDLE handle, HANDLE event, PIO_APC_ROUTI
 }
 
 
+/* cache of the entries of recently scanned directories, to avoid reading the whole
+ * directory again for every case-insensitive lookup */
+
+#define DIR_CACHE_COUNT 16
+
+struct dir_cache_entry
+{
+    unsigned int   next;       /* next entry in the hash chain, or ~0u */
+    unsigned int   unix_name;  /* offset of the unix name in the unix names buffer */
+    unsigned int   name;       /* offset of the Unicode name in the names buffer */
+    unsigned short len;        /* length of the Unicode name */
+    unsigned short is_short;   /* name is a generated 8.3 name */
+};
+
+struct dir_cache
+{
+    dev_t                   dev;
+    ino_t                   ino;
+    ULONGLONG               mtime;       /* directory modification time, in ns */
+    unsigned int            last_use;
+    unsigned int            count;
+    unsigned int            hash_size;   /* power of 2 */
+    unsigned int           *hash;
+    struct dir_cache_entry *entries;
+    WCHAR                  *names;
+    char                   *unix_names;
+};
+
+static pthread_mutex_t dir_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct dir_cache dir_cache[DIR_CACHE_COUNT];
+static unsigned int dir_cache_clock, dir_cache_hits, dir_cache_misses;
+
+static ULONGLONG get_mtime_ns( const struct stat *st )
+{
+    ULONGLONG ret = (ULONGLONG)st->st_mtime * 1000000000;
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+    ret += st->st_mtim.tv_nsec;
+#elif defined(HAVE_STRUCT_STAT_ST_MTIMESPEC)
+    ret += st->st_mtimespec.tv_nsec;
+#endif
+    return ret;
+}
+
+static unsigned int hash_dir_cache_name( const WCHAR *name, int len )
+{
+    unsigned int i, hash = 0;
+
+    for (i = 0; i < len; i++) hash = hash * 65599 + towupper( name[i] );
+    return hash;
+}
+
+static void free_dir_cache( struct dir_cache *cache )
+{
+    free( cache->hash );
+    free( cache->entries );
+    free( cache->names );
+    free( cache->unix_names );
+    memset( cache, 0, sizeof(*cache) );
+}
+
+/* add a name to the cache buffers, the hash table is built once all names are added */
+static BOOL add_dir_cache_name( struct dir_cache *cache, unsigned int *size, unsigned int *names_size,
+                                unsigned int *names_pos, const WCHAR *name, unsigned short len,
+                                unsigned int unix_name, BOOL is_short )
+{
+    struct dir_cache_entry *entry;
+
+    if (cache->count == *size)
+    {
+        unsigned int new_size = max( 64, *size * 2 );
+        if (!(entry = realloc( cache->entries, new_size * sizeof(*entry) ))) return FALSE;
+        cache->entries = entry;
+        *size = new_size;
+    }
+    if (*names_pos + len > *names_size)
+    {
+        unsigned int new_size = max( *names_pos + len, *names_size * 2 );
+        WCHAR *names;
+        if (!(names = realloc( cache->names, new_size * sizeof(WCHAR) ))) return FALSE;
+        cache->names = names;
+        *names_size = new_size;
+    }
+    memcpy( cache->names + *names_pos, name, len * sizeof(WCHAR) );
+    entry = &cache->entries[cache->count++];
+    entry->unix_name = unix_name;
+    entry->name = *names_pos;
+    entry->len = len;
+    entry->is_short = is_short;
+    *names_pos += len;
+    return TRUE;
+}
+
+/* read all the entries of a directory into a cache slot */
+static BOOL fill_dir_cache( struct dir_cache *cache, const char *dir )
+{
+    unsigned int i, size = 0, names_size = 0, names_pos = 0, unix_size = 0, unix_pos = 0;
+    WCHAR buffer[MAX_DIR_ENTRY_LEN], short_nameW[12];
+    struct dirent *de;
+    DIR *dirp;
+    int ret;
+
+    if (!(dirp = opendir( dir ))) return FALSE;
+
+    while ((de = readdir( dirp )))
+    {
+        unsigned int len = strlen( de->d_name ) + 1;
+
+        if (unix_pos + len > unix_size)
+        {
+            unsigned int new_size = max( unix_pos + len, max( 4096, unix_size * 2 ));
+            char *unix_names;
+            if (!(unix_names = realloc( cache->unix_names, new_size ))) goto failed;
+            cache->unix_names = unix_names;
+            unix_size = new_size;
+        }
+        memcpy( cache->unix_names + unix_pos, de->d_name, len );
+
+        ret = ntdll_umbstowcs( de->d_name, len - 1, buffer, MAX_DIR_ENTRY_LEN );
+        if (!add_dir_cache_name( cache, &size, &names_size, &names_pos, buffer, ret, unix_pos, FALSE ))
+            goto failed;
+        if (!is_legal_8dot3_name( buffer, ret ))
+        {
+            ret = hash_short_file_name( buffer, ret, short_nameW );
+            if (!add_dir_cache_name( cache, &size, &names_size, &names_pos, short_nameW, ret, unix_pos, TRUE ))
+                goto failed;
+        }
+        unix_pos += len;
+    }
+    closedir( dirp );
+
+    for (cache->hash_size = 16; cache->hash_size < cache->count * 2; cache->hash_size *= 2) /* nothing */;
+    if (!(cache->hash = malloc( cache->hash_size * sizeof(*cache->hash) ))) goto failed_closed;
+    memset( cache->hash, 0xff, cache->hash_size * sizeof(*cache->hash) );
+    /* insert backwards so that the chains are in readdir order, with each long name
+     * before its short name, like the search in find_file_in_dir() */
+    for (i = cache->count; i--;)
+    {
+        struct dir_cache_entry *entry = &cache->entries[i];
+        unsigned int hash = hash_dir_cache_name( cache->names + entry->name, entry->len ) & (cache->hash_size - 1);
+        entry->next = cache->hash[hash];
+        cache->hash[hash] = i;
+    }
+    return TRUE;
+
+failed:
+    closedir( dirp );
+failed_closed:
+    free_dir_cache( cache );
+    return FALSE;
+}
+
+/***********************************************************************
+ *           lookup_dir_cache
+ *
+ * Look for a file name in the cached entries of a directory, (re)reading the directory if needed.
+ * Returns 1 and appends the name if found, 0 if not found, -1 if the cache can't be used.
+ */
+static int lookup_dir_cache( const char *dir, const WCHAR *name, int length, BOOLEAN check_short,
+                             char *ret_name )
+{
+    struct dir_cache *cache = NULL, *lru = dir_cache;
+    const struct dir_cache_entry *entry, *found = NULL;
+    unsigned int i, hash;
+    struct stat st;
+    ULONGLONG mtime;
+
+    if (stat( dir, &st ) == -1) return -1;
+    mtime = get_mtime_ns( &st );
+
+    mutex_lock( &dir_cache_mutex );
+
+    for (i = 0; i < DIR_CACHE_COUNT; i++)
+    {
+        if (dir_cache[i].hash && dir_cache[i].dev == st.st_dev && dir_cache[i].ino == st.st_ino)
+        {
+            cache = &dir_cache[i];
+            break;
+        }
+        if (dir_cache[i].last_use < lru->last_use) lru = &dir_cache[i];
+    }
+
+    if (cache && cache->mtime != mtime)
+    {
+        free_dir_cache( cache );
+        lru = cache;
+        cache = NULL;
+    }
+    if (!cache)
+    {
+        dir_cache_misses++;
+        /* a directory modified in the last seconds could change again without its
+         * timestamp changing, so don't trust the cache for it yet */
+        if (st.st_mtime >= time( NULL ) - 1)
+        {
+            mutex_unlock( &dir_cache_mutex );
+            return -1;
+        }
+        free_dir_cache( lru );
+        if (!fill_dir_cache( lru, dir ))
+        {
+            mutex_unlock( &dir_cache_mutex );
+            return -1;
+        }
+        cache = lru;
+        cache->dev = st.st_dev;
+        cache->ino = st.st_ino;
+        cache->mtime = mtime;
+        TRACE( "cached %u names for %s, %u hits %u misses\n", cache->count, debugstr_a(dir),
+               dir_cache_hits, dir_cache_misses );
+    }
+    else dir_cache_hits++;
+
+    cache->last_use = ++dir_cache_clock;
+
+    hash = hash_dir_cache_name( name, length ) & (cache->hash_size - 1);
+    for (i = cache->hash[hash]; i != ~0u; i = entry->next)
+    {
+        entry = &cache->entries[i];
+        if (entry->len != length || wcsnicmp( cache->names + entry->name, name, length )) continue;
+        if (entry->is_short && !check_short) continue;
+        found = entry;
+        break;
+    }
+    if (found) strcpy( ret_name, cache->unix_names + found->unix_name );
+
+    mutex_unlock( &dir_cache_mutex );
+    return found != NULL;
+}
+
+
 /***********************************************************************
  *           find_file_in_dir
  *
@@ -2825,6 +3055,15 @@ static NTSTATUS find_file_in_dir( char *unix_name, int pos, const WCHAR *name, i
     }
 #endif /* VFAT_IOCTL_READDIR_BOTH */
 
+    switch (lookup_dir_cache( unix_name, name, length, is_name_8_dot_3, unix_name + pos ))
+    {
+    case 1:
+        unix_name[pos - 1] = '/';
+        return STATUS_SUCCESS;
+    case 0:
+        goto not_found;
+    }
+
     if (!(dir = opendir( unix_name ))) return errno_to_status( errno );
 
     unix_name[pos - 1] = '/';
@@ -5573,8 +5812,11 @@ struct async_file_read_job
 };
 
 
+#define MAX_ASYNC_FILE_READ_THREADS 4
+
 static struct list async_file_read_queue = LIST_INIT( async_file_read_queue );
 static struct async_file_read_job *async_file_read_running, *async_file_read_free;
+static unsigned int async_file_read_threads, async_file_read_idle;
 
 static void async_file_complete_io( struct async_file_read_job *job, NTSTATUS status, ULONG total )
 {
@@ -5599,8 +5841,9 @@ static void *async_file_read_thread(void *dummy)
     {
         while (!(entry = list_head( &async_file_read_queue )))
         {
+            async_file_read_idle++;
             pthread_cond_wait( &async_file_read_cond, &async_file_read_mutex );
-            continue;
+            async_file_read_idle--;
         }
 
         job = LIST_ENTRY( entry, struct async_file_read_job, queue_entry );
@@ -5680,20 +5923,21 @@ done:
     return NULL;
 }
 
-static pthread_once_t async_file_read_once = PTHREAD_ONCE_INIT;
-
-static void async_file_read_init(void)
+/* start another worker thread, so that several reads can be in flight; called with the mutex held */
+static void start_async_file_read_thread(void)
 {
     pthread_t async_file_read_thread_id;
     pthread_attr_t pthread_attr;
 
-    ERR("HACK: AC Odyssey async read workaround.\n");
+    if (!async_file_read_threads) ERR("HACK: AC Odyssey async read workaround.\n");
 
     pthread_attr_init( &pthread_attr );
     pthread_attr_setscope( &pthread_attr, PTHREAD_SCOPE_SYSTEM );
     pthread_attr_setdetachstate( &pthread_attr, PTHREAD_CREATE_DETACHED );
 
-    pthread_create( &async_file_read_thread_id, &pthread_attr, (void * (*)(void *))async_file_read_thread, NULL);
+    if (!pthread_create( &async_file_read_thread_id, &pthread_attr,
+                         (void * (*)(void *))async_file_read_thread, NULL ))
+        async_file_read_threads++;
     pthread_attr_destroy( &pthread_attr );
 }
 
@@ -5702,8 +5946,6 @@ static NTSTATUS queue_async_file_read( HANDLE handle, int unix_handle, int needs
 {
     struct async_file_read_job *job;
 
-    pthread_once( &async_file_read_once, async_file_read_init );
-
     NtResetEvent( event, NULL );
 
     pthread_mutex_lock( &async_file_read_mutex );
@@ -5735,6 +5977,17 @@ static NTSTATUS queue_async_file_read( HANDLE handle, int unix_handle, int needs
 
     list_add_tail( &async_file_read_queue, &job->queue_entry );
 
+    if (!async_file_read_idle && async_file_read_threads < MAX_ASYNC_FILE_READ_THREADS)
+        start_async_file_read_thread();
+    if (!async_file_read_threads)
+    {
+        list_remove( &job->queue_entry );
+        job->next = async_file_read_free;
+        async_file_read_free = job;
+        pthread_mutex_unlock( &async_file_read_mutex );
+        return STATUS_NO_MEMORY;
+    }
+
     pthread_cond_signal( &async_file_read_cond );
     pthread_mutex_unlock( &async_file_read_mutex );
 
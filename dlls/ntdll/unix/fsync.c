@@ -256,9 +256,12 @@ static void *get_shm( unsigned int idx )
 #define FSYNC_LIST_BLOCK_SIZE  (65536 / sizeof(struct fsync))
 #define FSYNC_LIST_ENTRIES     256
 
+/* The generation is incremented every time an entry is modified, so that a lookup racing
+ * with the handle being closed and reused for the same shm index can still detect it. */
 struct fsync_cache
 {
-    enum fsync_type type;
+    enum fsync_type type : 8;
+    unsigned int gen : 24;
     unsigned int shm_idx;
 };
 
@@ -274,10 +277,25 @@ static inline UINT_PTR handle_to_index( HANDLE handle, UINT_PTR *entry )
     return idx % FSYNC_LIST_BLOCK_SIZE;
 }
 
+/* atomically replace a cache entry, bumping its generation; returns the previous entry */
+static struct fsync_cache update_cache_entry( struct fsync_cache *ptr, enum fsync_type type, unsigned int shm_idx )
+{
+    struct fsync_cache old, cache;
+
+    *(uint64_t *)&old = __atomic_load_n( (uint64_t *)ptr, __ATOMIC_SEQ_CST );
+    do
+    {
+        cache.type = type;
+        cache.gen = old.gen + 1;
+        cache.shm_idx = shm_idx;
+    } while (!__atomic_compare_exchange_n( (uint64_t *)ptr, (uint64_t *)&old, *(uint64_t *)&cache,
+                                           FALSE, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST ));
+    return old;
+}
+
 static void add_to_list( HANDLE handle, enum fsync_type type, unsigned int shm_idx )
 {
     UINT_PTR entry, idx = handle_to_index( handle, &entry );
-    struct fsync_cache cache;
 
     if (entry >= FSYNC_LIST_ENTRIES)
     {
@@ -298,9 +316,7 @@ static void add_to_list( HANDLE handle, enum fsync_type type, unsigned int shm_i
         }
     }
 
-    cache.type = type;
-    cache.shm_idx = shm_idx;
-    __atomic_store_n( (uint64_t *)&fsync_list[entry][idx], *(uint64_t *)&cache, __ATOMIC_SEQ_CST );
+    update_cache_entry( &fsync_list[entry][idx], type, shm_idx );
 }
 
 static void grab_object( struct fsync *obj )
@@ -373,8 +389,8 @@ again:
     if (((int *)obj->shm)[2] < 2 ||
         *(uint64_t *)&cache != __atomic_load_n( (uint64_t *)&fsync_list[entry][idx], __ATOMIC_SEQ_CST ))
     {
-        /* This check does not strictly guarantee that we avoid the potential race but is supposed to greatly
-         * reduce the probability of that. */
+        /* The entry generation catches the handle being closed and reused for the same object, but the
+         * object may still have been freed before we grabbed it, so this only greatly reduces the race. */
         FIXME( "Cache changed while getting object, handle %p, shm_idx %d, refcount %d.\n",
                handle, cache.shm_idx, ((int *)obj->shm)[2] );
         put_object( obj );
@@ -441,6 +457,59 @@ static NTSTATUS get_object( HANDLE handle, struct fsync *obj )
     return ret;
 }
 
+static BOOL is_object_cached( HANDLE handle )
+{
+    UINT_PTR entry, idx = handle_to_index( handle, &entry );
+    struct fsync_cache cache;
+
+    if (entry >= FSYNC_LIST_ENTRIES || !fsync_list[entry]) return FALSE;
+    *(uint64_t *)&cache = __atomic_load_n( (uint64_t *)&fsync_list[entry][idx], __ATOMIC_SEQ_CST );
+    return cache.type && cache.shm_idx;
+}
+
+/* Retrieve the shm indices of all the handles which are not cached yet in a
+ * single server call, instead of one call per handle in get_object(). The
+ * status is set for the handles which the server failed to return. */
+static void prefetch_objects( DWORD count, const HANDLE *handles, NTSTATUS *status )
+{
+    struct __server_request_info reqs[MAXIMUM_WAIT_OBJECTS], *ptrs[MAXIMUM_WAIT_OBJECTS];
+    unsigned int i, fetch_count = 0, fetched[MAXIMUM_WAIT_OBJECTS];
+    struct fsync obj;
+    sigset_t sigset;
+
+    for (i = 0; i < count; i++) status[i] = STATUS_SUCCESS;
+    for (i = 0; i < count; i++)
+        if ((INT_PTR)handles[i] > 0 && !is_object_cached( handles[i] )) fetch_count++;
+    if (fetch_count < 2) return;
+
+    /* See get_object() for the uninterrupted section. */
+    server_enter_uninterrupted_section( &fd_cache_mutex, &sigset );
+    for (i = fetch_count = 0; i < count; i++)
+    {
+        if ((INT_PTR)handles[i] <= 0 || is_object_cached( handles[i] )) continue;
+        server_init_batch_request( &reqs[fetch_count], REQ_get_fsync_idx );
+        reqs[fetch_count].u.req.get_fsync_idx_request.handle = wine_server_obj_handle( handles[i] );
+        ptrs[fetch_count] = &reqs[fetch_count];
+        fetched[fetch_count++] = i;
+    }
+    if (fetch_count && !server_call_batch( ptrs, fetch_count ))
+    {
+        for (i = 0; i < fetch_count; i++)
+        {
+            const struct get_fsync_idx_reply *reply = &reqs[i].u.reply.get_fsync_idx_reply;
+
+            if ((status[fetched[i]] = reqs[i].u.reply.reply_header.error)) continue;
+            TRACE( "Got shm index %d for handle %p.\n", reply->shm_idx, handles[fetched[i]] );
+            add_to_list( handles[fetched[i]], reply->type, reply->shm_idx );
+            /* get_fsync_idx grabs a reference that the cache doesn't need. */
+            obj.type = reply->type;
+            obj.shm = get_shm( reply->shm_idx );
+            put_object( &obj );
+        }
+    }
+    server_leave_uninterrupted_section( &fd_cache_mutex, &sigset );
+}
+
 static NTSTATUS get_object_for_wait( HANDLE handle, struct fsync *obj, int *prev_pid )
 {
     NTSTATUS ret;
@@ -466,12 +535,8 @@ NTSTATUS fsync_close( HANDLE handle )
 
     if (entry < FSYNC_LIST_ENTRIES && fsync_list[entry])
     {
-        struct fsync_cache cache;
+        struct fsync_cache cache = update_cache_entry( &fsync_list[entry][idx], 0, 0 );
 
-        cache.type = 0;
-        cache.shm_idx = 0;
-        *(uint64_t *)&cache = __atomic_exchange_n( (uint64_t *)&fsync_list[entry][idx],
-                                                   *(uint64_t *)&cache, __ATOMIC_SEQ_CST );
         if (cache.type) return STATUS_SUCCESS;
     }
 
@@ -906,6 +971,9 @@ static NTSTATUS do_single_wait( int *addr, int val, const struct timespec64 *end
         return STATUS_PENDING;
 }
 
+static LONG fsync_wait_count;   /* number of waits handled by fsync */
+static LONG server_wait_count;  /* number of waits that had to fall back to the server */
+
 static void put_objects( struct fsync *objs, unsigned int count )
 {
     unsigned int i;
@@ -925,6 +993,7 @@ static NTSTATUS __fsync_wait_objects( DWORD count, const HANDLE *handles,
     struct futex_waitv futexes[MAXIMUM_WAIT_OBJECTS + 1];
     struct fsync objs[MAXIMUM_WAIT_OBJECTS];
     BOOL msgwait = FALSE, waited = FALSE;
+    NTSTATUS prefetch_status[MAXIMUM_WAIT_OBJECTS];
     int prev_pids[MAXIMUM_WAIT_OBJECTS];
     int has_fsync = 0, has_server = 0;
     clockid_t clock_id = 0;
@@ -954,9 +1023,11 @@ static NTSTATUS __fsync_wait_objects( DWORD count, const HANDLE *handles,
 
     get_wait_end_time( &timeout, &end, &clock_id );
 
+    prefetch_objects( count, handles, prefetch_status );
     for (i = 0; i < count; i++)
     {
-        ret = get_object_for_wait( handles[i], &objs[i], &prev_pids[i] );
+        if (!(ret = prefetch_status[i]))
+            ret = get_object_for_wait( handles[i], &objs[i], &prev_pids[i] );
         if (ret == STATUS_SUCCESS)
         {
             assert( objs[i].type );
@@ -964,6 +1035,7 @@ static NTSTATUS __fsync_wait_objects( DWORD count, const HANDLE *handles,
         }
         else if (ret == STATUS_NOT_IMPLEMENTED)
         {
+            TRACE( "no shm index for handle %p, need a server wait\n", handles[i] );
             objs[i].type = 0;
             objs[i].shm = NULL;
             has_server = 1;
@@ -983,8 +1055,11 @@ static NTSTATUS __fsync_wait_objects( DWORD count, const HANDLE *handles,
     else if (has_server)
     {
         put_objects( objs, count );
+        TRACE( "falling back to server wait, %d server waits / %d fsync waits so far\n",
+               (int)InterlockedIncrement( &server_wait_count ), (int)fsync_wait_count );
         return STATUS_NOT_IMPLEMENTED;
     }
+    else InterlockedIncrement( &fsync_wait_count );
 
     if (TRACE_ON(fsync))
     {
@@ -1009,6 +1009,8 @@ NTSTATUS WINAPI NtFlushKey( HANDLE key )
     data_size_t size = 0;
     unsigned int ret;
     char *data = NULL, *curr_data;
+    struct __server_request_info done_reqs[8], *done_ptrs[8];
+    unsigned int err = STATUS_SUCCESS;
     HANDLE mutex;
     int i, branch_count, branch;
 
@@ -1039,23 +1041,31 @@ NTSTATUS WINAPI NtFlushKey( HANDLE key )
         }
     }
     if (ret) goto done;
+    if (branch_count > ARRAY_SIZE(done_reqs))
+    {
+        ERR( "Too many branches %d.\n", branch_count );
+        ret = STATUS_INTERNAL_ERROR;
+        goto done;
+    }
 
+    /* acknowledge all the saved branches in a single server call */
     curr_data = data;
     for (i = 0; i < branch_count; ++i)
     {
         branch = *(int *)curr_data;
         curr_data += sizeof(int);
-        if ((ret = save_registry_branch( &curr_data ))) goto done;
+        if ((ret = save_registry_branch( &curr_data ))) break;
 
-        SERVER_START_REQ( flush_key_done )
-        {
-            req->branch = branch;
-            req->timestamp_counter = timestamp_counter;
-            ret = wine_server_call( req );
-        }
-        SERVER_END_REQ;
-        if (ret) break;
+        server_init_batch_request( &done_reqs[i], REQ_flush_key_done );
+        done_reqs[i].u.req.flush_key_done_request.branch = branch;
+        done_reqs[i].u.req.flush_key_done_request.timestamp_counter = timestamp_counter;
+        done_ptrs[i] = &done_reqs[i];
+    }
+    if (i && !(err = server_call_batch( done_ptrs, i )))
+    {
+        while (i-- && !err) err = done_reqs[i].u.reply.reply_header.error;
     }
+    if (!ret) ret = err;
 
 done:
     release_key_flush_mutex( mutex );
@@ -319,6 +319,84 @@ unsigned int CDECL wine_server_call( void *req_ptr )
 }
 
 
+static LONG batch_saved_calls;  /* number of server round trips avoided by batching */
+
+static inline data_size_t batch_entry_size( data_size_t size )
+{
+    return (size + BATCH_ENTRY_ALIGN - 1) & ~(BATCH_ENTRY_ALIGN - 1);
+}
+
+/***********************************************************************
+ *           server_call_batch
+ *
+ * Perform several independent server calls in a single round trip. The requests
+ * are executed in order, and each reply is filled as if the request had been
+ * sent with wine_server_call. Each request needs to be checked for errors.
+ */
+unsigned int server_call_batch( struct __server_request_info **reqs, unsigned int count )
+{
+    ULONG64 static_buffer[512];
+    char *buffer = (char *)static_buffer, *ptr;
+    data_size_t req_size = 0, reply_size = 0, pos = 0;
+    unsigned int i, j, done = 0, ret;
+
+    if (count == 1) return wine_server_call( reqs[0] );
+    if (count > BATCH_MAX_REQUESTS) return STATUS_INVALID_PARAMETER;
+
+    for (i = 0; i < count; i++)
+    {
+        req_size += batch_entry_size( sizeof(reqs[i]->u.req) + reqs[i]->u.req.request_header.request_size );
+        reply_size += batch_entry_size( sizeof(reqs[i]->u.reply) + reqs[i]->u.req.request_header.reply_size );
+    }
+    if (req_size + reply_size > sizeof(static_buffer) && !(buffer = malloc( req_size + reply_size )))
+        return STATUS_NO_MEMORY;
+
+    for (i = 0, ptr = buffer; i < count; i++)
+    {
+        data_size_t size = sizeof(reqs[i]->u.req) + reqs[i]->u.req.request_header.request_size;
+
+        memcpy( ptr, &reqs[i]->u.req, sizeof(reqs[i]->u.req) );
+        ptr += sizeof(reqs[i]->u.req);
+        for (j = 0; j < reqs[i]->data_count; j++)
+        {
+            memcpy( ptr, reqs[i]->data[j].ptr, reqs[i]->data[j].size );
+            ptr += reqs[i]->data[j].size;
+        }
+        memset( ptr, 0, batch_entry_size( size ) - size );
+        ptr += batch_entry_size( size ) - size;
+    }
+
+    SERVER_START_REQ( batch_requests )
+    {
+        wine_server_add_data( req, buffer, req_size );
+        wine_server_set_reply( req, buffer + req_size, reply_size );
+        if (!(ret = wine_server_call( req ))) done = reply->count;
+    }
+    SERVER_END_REQ;
+
+    for (i = 0, ptr = buffer + req_size; i < done; i++)
+    {
+        const union generic_reply *reply = (const union generic_reply *)(ptr + pos);
+
+        reqs[i]->u.reply = *reply;
+        if (reply->reply_header.reply_size)
+            memcpy( reqs[i]->reply_data, reply + 1, reply->reply_header.reply_size );
+        pos += batch_entry_size( sizeof(*reply) + reply->reply_header.reply_size );
+    }
+    for (; i < count; i++)
+    {
+        memset( &reqs[i]->u.reply, 0, sizeof(reqs[i]->u.reply) );
+        reqs[i]->u.reply.reply_header.error = ret ? ret : STATUS_NO_MEMORY;
+    }
+
+    if (done > 1)
+        TRACE( "%u requests in one call, %d round trips saved so far\n",
+               done, (int)InterlockedExchangeAdd( &batch_saved_calls, done - 1 ) + done - 1 );
+    if (buffer != (char *)static_buffer) free( buffer );
+    return ret;
+}
+
+
 /***********************************************************************
  *           server_enter_uninterrupted_section
  */
@@ -1752,8 +1830,17 @@ NTSTATUS WINAPI NtDuplicateObject( HANDLE source_process, HANDLE source, HANDLE
     /* always remove the cached fd; if the server request fails we'll just
      * retrieve it again */
     if (options & DUPLICATE_CLOSE_SOURCE)
+    {
         fd = remove_fd_from_cache( source );
 
+        /* the source handle value may be reused, so the cached sync objects must go too */
+        if (do_fsync())
+            fsync_close( source );
+
+        if (do_esync())
+            esync_close( source );
+    }
+
     SERVER_START_REQ( dup_handle )
     {
         req->src_process = wine_server_obj_handle( source_process );
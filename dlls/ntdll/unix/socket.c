@@ -42,6 +42,9 @@
 #ifdef HAVE_NETINET_TCP_H
 # include <netinet/tcp.h>
 #endif
+#ifdef __linux__
+# include <sys/sendfile.h>
+#endif
 
 #ifdef HAVE_NETIPX_IPX_H
 # include <netipx/ipx.h>
@@ -150,6 +153,7 @@ struct async_transmit_ioctl
     unsigned int head_len;
     unsigned int tail_len;
     LARGE_INTEGER offset;
+    BOOL use_sendfile;          /* file data is sent with sendfile() rather than through the buffer */
 };
 
 static int get_sock_type( HANDLE handle );
@@ -1129,7 +1133,7 @@ static NTSTATUS sock_send( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, voi
                            IO_STATUS_BLOCK *io, int fd, struct async_send_ioctl *async, int force_async )
 {
     HANDLE wait_handle;
-    BOOL nonblocking;
+    BOOL nonblocking, icmp_over_dgram;
     unsigned int status;
     ULONG options;
 
@@ -1141,13 +1145,14 @@ static NTSTATUS sock_send( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, voi
         wait_handle = wine_server_ptr_handle( reply->wait );
         options     = reply->options;
         nonblocking = reply->nonblocking;
+        icmp_over_dgram = reply->icmp_over_dgram;
     }
     SERVER_END_REQ;
 
     /* the server currently will never succeed immediately */
     assert(status == STATUS_ALERTED || status == STATUS_PENDING || NT_ERROR(status));
 
-    if (!NT_ERROR(status) && is_icmp_over_dgram( fd ))
+    if (!NT_ERROR(status) && icmp_over_dgram)
         sock_save_icmp_id( async );
 
     if (status == STATUS_ALERTED)
@@ -1257,15 +1262,69 @@ static ssize_t do_send( int fd, const void *buffer, size_t len, int flags )
     return ret;
 }
 
+#ifdef __linux__
+/* send file data directly from the file to the socket, without copying it through user space */
+static NTSTATUS try_sendfile( int sock_fd, int file_fd, struct async_transmit_ioctl *async )
+{
+    ssize_t ret;
+    off_t offset;
+    size_t count;
+
+    while (async->file)
+    {
+        count = async->file_len ? async->file_len - async->file_cursor : 0x7ffff000;
+
+        TRACE( "sending %zu bytes of file data with sendfile\n", count );
+        do
+        {
+            if (async->offset.QuadPart == FILE_USE_FILE_POINTER_POSITION)
+                ret = sendfile( sock_fd, file_fd, NULL, count );
+            else
+            {
+                offset = async->offset.QuadPart;
+                ret = sendfile( sock_fd, file_fd, &offset, count );
+            }
+        } while (ret < 0 && errno == EINTR);
+
+        if (ret < 0)
+        {
+            if (errno == EINVAL || errno == ENOSYS)
+            {
+                TRACE( "sendfile not supported, falling back to read\n" );
+                async->use_sendfile = FALSE;
+                return STATUS_SUCCESS;
+            }
+            if (errno != EWOULDBLOCK) WARN( "sendfile: %s\n", strerror( errno ) );
+            return sock_errno_to_status( errno );
+        }
+        TRACE( "sendfile returned %zd\n", ret );
+
+        async->file_cursor += ret;
+        if (async->offset.QuadPart != FILE_USE_FILE_POINTER_POSITION)
+            async->offset.QuadPart += ret;
+
+        if (!ret || (async->file_len && async->file_cursor == async->file_len))
+            async->file = NULL;
+    }
+    return STATUS_SUCCESS;
+}
+#endif
+
 static NTSTATUS try_transmit( int sock_fd, int file_fd, struct async_transmit_ioctl *async )
 {
+    /* let the kernel coalesce header and file data with the tail, which always flushes */
+#ifdef MSG_MORE
+    int more_flags = async->tail_len ? MSG_MORE : 0;
+#else
+    int more_flags = 0;
+#endif
     ssize_t ret;
 
     while (async->head_cursor < async->head_len)
     {
         TRACE( "sending %u bytes of header data\n", async->head_len - async->head_cursor );
         ret = do_send( sock_fd, async->head + async->head_cursor,
-                       async->head_len - async->head_cursor, 0 );
+                       async->head_len - async->head_cursor, more_flags );
         if (ret < 0) return sock_errno_to_status( errno );
         TRACE( "send returned %zd\n", ret );
         async->head_cursor += ret;
@@ -1275,13 +1334,22 @@ static NTSTATUS try_transmit( int sock_fd, int file_fd, struct async_transmit_io
     {
         TRACE( "sending %u bytes of file data\n", async->read_len - async->buffer_cursor );
         ret = do_send( sock_fd, async->buffer + async->buffer_cursor,
-                       async->read_len - async->buffer_cursor, 0 );
+                       async->read_len - async->buffer_cursor, more_flags );
         if (ret < 0) return sock_errno_to_status( errno );
         TRACE( "send returned %zd\n", ret );
         async->buffer_cursor += ret;
         async->file_cursor += ret;
     }
 
+#ifdef __linux__
+    if (async->file && async->use_sendfile)
+    {
+        NTSTATUS status;
+
+        if ((status = try_sendfile( sock_fd, file_fd, async ))) return status;
+    }
+#endif
+
     if (async->file && async->buffer_cursor == async->read_len)
     {
         unsigned int read_size = async->buffer_size;
@@ -1406,6 +1474,7 @@ static NTSTATUS sock_transmit( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc,
     async->tail = u64_to_user_ptr(params->tail_ptr);
     async->tail_len = params->tail_len;
     async->offset = params->offset;
+    async->use_sendfile = TRUE;
 
     SERVER_START_REQ( send_socket )
     {
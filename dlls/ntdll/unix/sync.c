@@ -1996,7 +1996,8 @@ NTSTATUS WINAPI NtRemoveIoCompletion( HANDLE handle, ULONG_PTR *key, ULONG_PTR *
 NTSTATUS WINAPI NtRemoveIoCompletionEx( HANDLE handle, FILE_IO_COMPLETION_INFORMATION *info, ULONG count,
                                         ULONG *written, LARGE_INTEGER *timeout, BOOLEAN alertable )
 {
-    unsigned int status;
+    struct completion_packet packets[64];
+    unsigned int status, j, extra;
     int waited = 0;
     ULONG i = 0;
 
@@ -2006,21 +2007,33 @@ NTSTATUS WINAPI NtRemoveIoCompletionEx( HANDLE handle, FILE_IO_COMPLETION_INFORM
     {
         while (i < count)
         {
+            /* fetch as many packets as possible in a single request */
+            extra = min( count - i - 1, ARRAY_SIZE(packets) );
             SERVER_START_REQ( remove_completion )
             {
                 req->handle = wine_server_obj_handle( handle );
                 req->waited = waited;
+                req->extra  = extra;
+                if (extra) wine_server_set_reply( req, packets, extra * sizeof(packets[0]) );
                 if (!(status = wine_server_call( req )))
                 {
                     info[i].CompletionKey             = reply->ckey;
                     info[i].CompletionValue           = reply->cvalue;
                     info[i].IoStatusBlock.Information = reply->information;
                     info[i].IoStatusBlock.u.Status    = reply->status;
+                    extra = wine_server_reply_size( reply ) / sizeof(packets[0]);
                 }
             }
             SERVER_END_REQ;
             if (status != STATUS_SUCCESS) break;
             ++i;
+            for (j = 0; j < extra; j++, i++)
+            {
+                info[i].CompletionKey             = packets[j].ckey;
+                info[i].CompletionValue           = packets[j].cvalue;
+                info[i].IoStatusBlock.Information = packets[j].information;
+                info[i].IoStatusBlock.u.Status    = packets[j].status;
+            }
         }
         if (i || status != STATUS_PENDING)
         {
@@ -40,6 +40,9 @@
 #ifdef HAVE_SYS_TIMES_H
 #include <sys/times.h>
 #endif
+#ifdef HAVE_SYS_RESOURCE_H
+#include <sys/resource.h>
+#endif
 #ifdef HAVE_SYS_SYSCALL_H
 #include <sys/syscall.h>
 #endif
@@ -1873,6 +1876,21 @@ BOOL get_thread_times(int unix_pid, int unix_tid, LARGE_INTEGER *kernel_time, LA
 #endif
 }
 
+/* get the times of the current thread without going through the server or procfs */
+static BOOL get_current_thread_times( LARGE_INTEGER *kernel_time, LARGE_INTEGER *user_time )
+{
+#if defined(HAVE_SYS_RESOURCE_H) && defined(RUSAGE_THREAD)
+    struct rusage usage;
+
+    if (getrusage( RUSAGE_THREAD, &usage ) == -1) return FALSE;
+    kernel_time->QuadPart = 10000000 * (ULONGLONG)usage.ru_stime.tv_sec + 10 * (ULONGLONG)usage.ru_stime.tv_usec;
+    user_time->QuadPart = 10000000 * (ULONGLONG)usage.ru_utime.tv_sec + 10 * (ULONGLONG)usage.ru_utime.tv_usec;
+    return TRUE;
+#else
+    return FALSE;
+#endif
+}
+
 static void set_native_thread_name( HANDLE handle, const UNICODE_STRING *name )
 {
 #ifdef linux
@@ -2038,9 +2056,22 @@ NTSTATUS WINAPI NtQueryInformationThread( HANDLE handle, THREADINFOCLASS class,
 
     case ThreadTimes:
     {
+        struct ntdll_thread_data *thread_data = ntdll_get_thread_data();
         KERNEL_USER_TIMES kusrt;
         int unix_pid, unix_tid;
 
+        /* the creation time of the current thread doesn't change, so once
+         * it is known the server doesn't need to be involved */
+        if (handle == GetCurrentThread() && thread_data->creation_time &&
+            get_current_thread_times( &kusrt.KernelTime, &kusrt.UserTime ))
+        {
+            kusrt.CreateTime.QuadPart = thread_data->creation_time;
+            kusrt.ExitTime.QuadPart = 0;
+            if (data) memcpy( data, &kusrt, min( length, sizeof(kusrt) ));
+            if (ret_len) *ret_len = min( length, sizeof(kusrt) );
+            return STATUS_SUCCESS;
+        }
+
         SERVER_START_REQ( get_thread_times )
         {
             req->handle = wine_server_obj_handle( handle );
@@ -2059,7 +2090,12 @@ NTSTATUS WINAPI NtQueryInformationThread( HANDLE handle, THREADINFOCLASS class,
             BOOL ret = FALSE;
 
             kusrt.KernelTime.QuadPart = kusrt.UserTime.QuadPart = 0;
-            if (unix_pid != -1 && unix_tid != -1)
+            if (handle == GetCurrentThread())
+            {
+                thread_data->creation_time = kusrt.CreateTime.QuadPart;
+                ret = get_current_thread_times( &kusrt.KernelTime, &kusrt.UserTime );
+            }
+            if (!ret && unix_pid != -1 && unix_tid != -1)
                 ret = get_thread_times( unix_pid, unix_tid, &kusrt.KernelTime, &kusrt.UserTime );
             if (!ret && handle == GetCurrentThread())
             {
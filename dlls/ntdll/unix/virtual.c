@@ -63,6 +63,10 @@
 # include <mach/mach_init.h>
 # include <mach/mach_vm.h>
 #endif
+#ifdef __linux__
+# include <sys/ioctl.h>
+# include <sys/syscall.h>
+#endif
 
 #include <sys/uio.h>
 
@@ -214,10 +218,78 @@ static BYTE *pages_vprot;
 #endif
 
 static BOOL use_kernel_writewatch;
-static int pagemap_fd, pagemap_reset_fd, clear_refs_fd;
+static int pagemap_fd, pagemap_reset_fd, clear_refs_fd, uffd_fd = -1;
 #define PAGE_FLAGS_BUFFER_LENGTH 1024
 #define PM_SOFT_DIRTY_PAGE (1ull << 57)
 
+#if defined(__linux__) && defined(__NR_userfaultfd)
+/* userfaultfd asynchronous write protection and PAGEMAP_SCAN, from Linux 6.7 */
+#define UFFD_API_VERSION 0xaa
+#define UFFD_USER_MODE_ONLY 1
+#define UFFD_FEATURE_WP_UNPOPULATED (1 << 13)
+#define UFFD_FEATURE_WP_ASYNC (1 << 15)
+#define UFFD_REGISTER_MODE_WP (1 << 1)
+#define UFFD_WRITEPROTECT_MODE_WP (1 << 0)
+
+struct uffd_range
+{
+    UINT64 start;
+    UINT64 len;
+};
+
+struct uffd_api_args
+{
+    UINT64 api;
+    UINT64 features;
+    UINT64 ioctls;
+};
+
+struct uffd_register_args
+{
+    struct uffd_range range;
+    UINT64 mode;
+    UINT64 ioctls;
+};
+
+struct uffd_writeprotect_args
+{
+    struct uffd_range range;
+    UINT64 mode;
+};
+
+#define UFFD_IOC_API          _IOWR( 0xaa, 0x3f, struct uffd_api_args )
+#define UFFD_IOC_REGISTER     _IOWR( 0xaa, 0x00, struct uffd_register_args )
+#define UFFD_IOC_WRITEPROTECT _IOWR( 0xaa, 0x06, struct uffd_writeprotect_args )
+
+#define PM_PAGE_IS_WRITTEN  (1 << 1)
+#define PM_SCAN_WP_MATCHING (1 << 0)
+
+struct pm_page_region
+{
+    UINT64 start;
+    UINT64 end;
+    UINT64 categories;
+};
+
+struct pm_scan_args
+{
+    UINT64 size;
+    UINT64 flags;
+    UINT64 start;
+    UINT64 end;
+    UINT64 walk_end;
+    UINT64 vec;
+    UINT64 vec_len;
+    UINT64 max_pages;
+    UINT64 category_inverted;
+    UINT64 category_mask;
+    UINT64 category_anyof_mask;
+    UINT64 return_mask;
+};
+
+#define PM_IOC_SCAN _IOWR( 'f', 16, struct pm_scan_args )
+#endif
+
 static void reset_write_watches( void *base, SIZE_T size );
 
 static struct file_view *view_block_start, *view_block_end, *next_free_view;
@@ -239,6 +311,41 @@ struct range_entry
 static struct range_entry *free_ranges;
 static struct range_entry *free_ranges_end;
 
+/* virtual_mutex bookkeeping: the sequence is odd while the mutex is held, so that
+ * read-only queries can walk the views optimistically and detect concurrent changes */
+static unsigned int virtual_lock_seq;
+static unsigned int virtual_lock_depth;
+static unsigned int virtual_lock_contended;
+static unsigned int lockless_query_count, lockless_query_retries;
+
+static void virtual_mutex_lock(void)
+{
+    if (!process_exiting && pthread_mutex_trylock( &virtual_mutex ))
+    {
+        __atomic_add_fetch( &virtual_lock_contended, 1, __ATOMIC_RELAXED );
+        mutex_lock( &virtual_mutex );
+    }
+    if (!virtual_lock_depth++) __atomic_add_fetch( &virtual_lock_seq, 1, __ATOMIC_SEQ_CST );
+}
+
+static void virtual_mutex_unlock(void)
+{
+    if (!--virtual_lock_depth) __atomic_add_fetch( &virtual_lock_seq, 1, __ATOMIC_RELEASE );
+    mutex_unlock( &virtual_mutex );
+}
+
+static void virtual_lock( sigset_t *sigset )
+{
+    pthread_sigmask( SIG_BLOCK, &server_block_set, sigset );
+    virtual_mutex_lock();
+}
+
+static void virtual_unlock( sigset_t *sigset )
+{
+    virtual_mutex_unlock();
+    pthread_sigmask( SIG_SETMASK, sigset, NULL );
+}
+
 
 static inline BOOL is_beyond_limit( const void *addr, size_t size, const void *limit )
 {
@@ -661,7 +768,7 @@ void *get_builtin_so_handle( void *module )
     void *ret = NULL;
     struct builtin_module *builtin;
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock( &sigset );
     LIST_FOR_EACH_ENTRY( builtin, &builtin_modules, struct builtin_module, entry )
     {
         if (builtin->module != module) continue;
@@ -669,7 +776,7 @@ void *get_builtin_so_handle( void *module )
         if (ret) builtin->refcount++;
         break;
     }
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock( &sigset );
     return ret;
 }
 
@@ -694,7 +801,7 @@ static NTSTATUS get_builtin_unix_funcs( void *module, BOOL wow, const void **fun
         return STATUS_SUCCESS;
     }
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock( &sigset );
     LIST_FOR_EACH_ENTRY( builtin, &builtin_modules, struct builtin_module, entry )
     {
         if (builtin->module != module) continue;
@@ -717,7 +824,7 @@ static NTSTATUS get_builtin_unix_funcs( void *module, BOOL wow, const void **fun
         }
         break;
     }
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock( &sigset );
     return status;
 }
 
@@ -731,7 +838,7 @@ NTSTATUS load_builtin_unixlib( void *module, const char *name )
     NTSTATUS status = STATUS_SUCCESS;
     struct builtin_module *builtin;
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock( &sigset );
     LIST_FOR_EACH_ENTRY( builtin, &builtin_modules, struct builtin_module, entry )
     {
         if (builtin->module != module) continue;
@@ -740,7 +847,7 @@ NTSTATUS load_builtin_unixlib( void *module, const char *name )
         if (!builtin->unix_handle) builtin->unix_handle = dlopen( builtin->unix_path, RTLD_NOW );
         break;
     }
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock( &sigset );
     return status;
 }
 
@@ -960,6 +1067,8 @@ static SIZE_T get_vprot_range_size( char *base, SIZE_T size, BYTE mask, BYTE *vp
 {
     static const UINT_PTR word_from_byte = (UINT_PTR)0x101010101010101;
     static const UINT_PTR index_align_mask = sizeof(UINT_PTR) - 1;
+    static const SIZE_T block_size = 4 * sizeof(UINT_PTR);
+    static const UINT_PTR block_align_mask = 4 * sizeof(UINT_PTR) - 1;
     SIZE_T curr_idx, start_idx, end_idx, aligned_start_idx;
     UINT_PTR vprot_word, mask_word;
     const BYTE *vprot_ptr;
@@ -987,17 +1096,32 @@ static SIZE_T get_vprot_range_size( char *base, SIZE_T size, BYTE mask, BYTE *vp
 
     vprot_word = word_from_byte * *vprot;
     mask_word = word_from_byte * mask;
-    for (; curr_idx < end_idx; curr_idx += sizeof(UINT_PTR), vprot_ptr += sizeof(UINT_PTR))
+    while (curr_idx < end_idx)
     {
 #ifdef _WIN64
         if (!(curr_idx & pages_vprot_mask)) vprot_ptr = pages_vprot[curr_idx >> pages_vprot_shift];
 #endif
+        /* skip whole blocks at once over large uniform ranges; blocks never cross a directory */
+        if (!(curr_idx & block_align_mask) && end_idx - curr_idx >= block_size)
+        {
+            const UINT_PTR *block = (const UINT_PTR *)vprot_ptr;
+
+            if (!(((block[0] ^ vprot_word) | (block[1] ^ vprot_word) |
+                   (block[2] ^ vprot_word) | (block[3] ^ vprot_word)) & mask_word))
+            {
+                curr_idx += block_size;
+                vprot_ptr += block_size;
+                continue;
+            }
+        }
         if ((vprot_word ^ *(UINT_PTR *)vprot_ptr) & mask_word)
         {
             for (; curr_idx < end_idx; ++curr_idx, ++vprot_ptr)
                 if ((*vprot ^ *vprot_ptr) & mask) break;
             return (curr_idx - start_idx) << page_shift;
         }
+        curr_idx += sizeof(UINT_PTR);
+        vprot_ptr += sizeof(UINT_PTR);
     }
     return size;
 }
@@ -1033,18 +1157,32 @@ static void set_page_vprot( const void *addr, size_t size, BYTE vprot )
  */
 static void set_page_vprot_bits( const void *addr, size_t size, BYTE set, BYTE clear )
 {
+    static const UINT_PTR word_from_byte = (UINT_PTR)0x101010101010101;
+    UINT_PTR set_word = word_from_byte * set, clear_word = word_from_byte * clear;
     size_t idx = (size_t)addr >> page_shift;
     size_t end = ((size_t)addr + size + page_mask) >> page_shift;
+    size_t count;
+    BYTE *ptr;
 
-#ifdef _WIN64
-    for ( ; idx < end; idx++)
+    while (idx < end)
     {
-        BYTE *ptr = pages_vprot[idx >> pages_vprot_shift] + (idx & pages_vprot_mask);
-        *ptr = (*ptr & ~clear) | set;
-    }
+#ifdef _WIN64
+        ptr = pages_vprot[idx >> pages_vprot_shift] + (idx & pages_vprot_mask);
+        count = min( end - idx, pages_vprot_mask + 1 - (idx & pages_vprot_mask) );
 #else
-    for ( ; idx < end; idx++) pages_vprot[idx] = (pages_vprot[idx] & ~clear) | set;
+        ptr = pages_vprot + idx;
+        count = end - idx;
 #endif
+        idx += count;
+
+        /* update a word at a time, the directories are word aligned */
+        for ( ; count && ((UINT_PTR)ptr & (sizeof(UINT_PTR) - 1)); count--, ptr++)
+            *ptr = (*ptr & ~clear) | set;
+        for ( ; count >= sizeof(UINT_PTR); count -= sizeof(UINT_PTR), ptr += sizeof(UINT_PTR))
+            *(UINT_PTR *)ptr = (*(UINT_PTR *)ptr & ~clear_word) | set_word;
+        for ( ; count; count--, ptr++)
+            *ptr = (*ptr & ~clear) | set;
+    }
 }
 
 
@@ -1178,12 +1316,12 @@ static void VIRTUAL_Dump(void)
     struct file_view *view;
 
     TRACE( "Dump of all virtual memory views:\n" );
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock( &sigset );
     WINE_RB_FOR_EACH_ENTRY( view, &views_tree, struct file_view, entry )
     {
         dump_view( view );
     }
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock( &sigset );
 }
 #endif
 
@@ -1233,6 +1371,10 @@ static void dump_memory_statistics(void)
     TRACE_(virtstat)( "Total: res %lu, comm %lu; Anon: res %lu, comm %lu, marked Unix %lu.\n",
                       anon_reserved + mapped, anon_committed + mapped_committed, anon_reserved, anon_committed,
                       marked_native );
+    TRACE_(virtstat)( "Lock: contended %u; lockless queries %u, retries %u.\n",
+                      __atomic_load_n( &virtual_lock_contended, __ATOMIC_RELAXED ),
+                      __atomic_load_n( &lockless_query_count, __ATOMIC_RELAXED ),
+                      __atomic_load_n( &lockless_query_retries, __ATOMIC_RELAXED ) );
 }
 
 /***********************************************************************
@@ -1821,6 +1963,26 @@ static void update_write_watches( void *base, size_t size, size_t accessed_size
  */
 static void reset_write_watches( void *base, SIZE_T size )
 {
+#ifdef PM_IOC_SCAN
+    if (uffd_fd != -1)
+    {
+        struct uffd_register_args reg;
+        struct uffd_writeprotect_args wp;
+
+        /* registering again is a no-op, but the range may have been remapped since */
+        reg.range.start = (ULONG_PTR)base;
+        reg.range.len = size;
+        reg.mode = UFFD_REGISTER_MODE_WP;
+        if (ioctl( uffd_fd, UFFD_IOC_REGISTER, &reg ) == -1)
+            ERR( "Could not register %p-%p, error %s.\n", base, (char *)base + size, strerror(errno) );
+
+        wp.range = reg.range;
+        wp.mode = UFFD_WRITEPROTECT_MODE_WP;
+        if (ioctl( uffd_fd, UFFD_IOC_WRITEPROTECT, &wp ) == -1)
+            ERR( "Could not write protect %p-%p, error %s.\n", base, (char *)base + size, strerror(errno) );
+        return;
+    }
+#endif
     if (use_kernel_writewatch)
     {
         char buffer[17];
@@ -2482,6 +2644,104 @@ static NTSTATUS map_pe_header( void *ptr, size_t size, int fd, BOOL *removable )
 }
 
 
+/***********************************************************************
+ *           relocate_image_view
+ *
+ * Apply the base relocations of a DLL that could not be mapped at its
+ * preferred base, while the pages are still writable. The loader then finds
+ * the image already at its base and doesn't need to change page protections
+ * twice for every section.
+ * virtual_mutex must be held by caller.
+ */
+static void relocate_image_view( struct file_view *view, IMAGE_NT_HEADERS *nt )
+{
+    const IMAGE_BASE_RELOCATION *rel, *end, *block;
+    const IMAGE_DATA_DIRECTORY *dir;
+    const USHORT *relocs;
+    char *ptr = view->base;
+    ULONG_PTR image_base;
+    BOOL is_64bit;
+    UINT count, width;
+
+    if (!(nt->FileHeader.Characteristics & IMAGE_FILE_DLL)) return;
+    if (nt->FileHeader.Characteristics & IMAGE_FILE_RELOCS_STRIPPED) return;
+
+    if (nt->OptionalHeader.Magic == IMAGE_NT_OPTIONAL_HDR64_MAGIC)
+    {
+        const IMAGE_NT_HEADERS64 *nt64 = (const IMAGE_NT_HEADERS64 *)nt;
+
+        if (nt64->OptionalHeader.SectionAlignment < page_size) return;
+        if (nt64->OptionalHeader.NumberOfRvaAndSizes <= IMAGE_DIRECTORY_ENTRY_BASERELOC) return;
+        image_base = nt64->OptionalHeader.ImageBase;
+        dir = &nt64->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_BASERELOC];
+        is_64bit = TRUE;
+    }
+    else if (nt->OptionalHeader.Magic == IMAGE_NT_OPTIONAL_HDR32_MAGIC)
+    {
+        const IMAGE_NT_HEADERS32 *nt32 = (const IMAGE_NT_HEADERS32 *)nt;
+
+        if (nt32->OptionalHeader.SectionAlignment < page_size) return;
+        if (nt32->OptionalHeader.NumberOfRvaAndSizes <= IMAGE_DIRECTORY_ENTRY_BASERELOC) return;
+        image_base = nt32->OptionalHeader.ImageBase;
+        dir = &nt32->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_BASERELOC];
+        is_64bit = FALSE;
+    }
+    else return;
+
+    if (image_base == (ULONG_PTR)ptr) return;
+    if (!dir->VirtualAddress || !dir->Size) return;
+    if (dir->VirtualAddress >= view->size || dir->Size > view->size - dir->VirtualAddress) return;
+
+    rel = (const IMAGE_BASE_RELOCATION *)(ptr + dir->VirtualAddress);
+    end = (const IMAGE_BASE_RELOCATION *)(ptr + dir->VirtualAddress + dir->Size);
+
+    /* check everything first, anything unusual is left to the loader */
+    for (block = rel; block < end - 1 && block->SizeOfBlock;
+         block = (const IMAGE_BASE_RELOCATION *)((const char *)block + block->SizeOfBlock))
+    {
+        if (block->VirtualAddress > view->size - page_size) return;
+        if (block->SizeOfBlock < sizeof(*block) || (block->SizeOfBlock & 1)) return;
+        if (block->SizeOfBlock > (const char *)end - (const char *)block) return;
+
+        relocs = (const USHORT *)(block + 1);
+        for (count = (block->SizeOfBlock - sizeof(*block)) / sizeof(USHORT); count; count--, relocs++)
+        {
+            switch (*relocs >> 12)
+            {
+            case IMAGE_REL_BASED_ABSOLUTE:
+                continue;
+            case IMAGE_REL_BASED_HIGH:
+            case IMAGE_REL_BASED_LOW:
+                width = sizeof(short);
+                break;
+            case IMAGE_REL_BASED_HIGHLOW:
+                width = sizeof(int);
+                break;
+            case IMAGE_REL_BASED_DIR64:
+                if (is_64bit)
+                {
+                    width = sizeof(INT64);
+                    break;
+                }
+                /* fall through */
+            default:
+                return;
+            }
+            /* the fixup must be entirely inside the view */
+            if ((*relocs & 0xfff) + width > view->size - block->VirtualAddress) return;
+        }
+    }
+
+    TRACE_(module)( "relocating %p-%p from %p\n", ptr, ptr + view->size, (void *)image_base );
+
+    while (rel < end - 1 && rel->SizeOfBlock)
+        rel = process_relocation_block( ptr, rel, ptr - (char *)image_base );
+
+    if (is_64bit) ((IMAGE_NT_HEADERS64 *)nt)->OptionalHeader.ImageBase = (ULONG_PTR)ptr;
+    else ((IMAGE_NT_HEADERS32 *)nt)->OptionalHeader.ImageBase = PtrToUlong( ptr );
+}
+
+
 /***********************************************************************
  *           map_image_into_view
  *
@@ -2648,6 +2908,8 @@ static NTSTATUS map_image_into_view( struct file_view *view, const WCHAR *filena
         }
     }
 
+    relocate_image_view( view, nt );
+
     /* set the image protections */
 
     set_vprot( view, ptr, ROUND_SIZE( 0, header_size ), VPROT_COMMITTED | VPROT_READ );
@@ -2756,7 +3018,7 @@ static NTSTATUS virtual_map_image( HANDLE mapping, ACCESS_MASK access, void **ad
     }
 
     status = STATUS_INVALID_PARAMETER;
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock( &sigset );
 
     base = wine_server_get_ptr( image_info->base );
     if ((ULONG_PTR)base != image_info->base) base = NULL;
@@ -2797,7 +3059,7 @@ static NTSTATUS virtual_map_image( HANDLE mapping, ACCESS_MASK access, void **ad
     else delete_view( view );
 
 done:
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock( &sigset );
     if (needs_close) close( unix_fd );
     if (shared_needs_close) close( shared_fd );
     return status;
@@ -2891,7 +3153,7 @@ static unsigned int virtual_map_section( HANDLE handle, PVOID *addr_ptr, ULONG_P
 
     if ((res = server_get_unix_fd( handle, 0, &unix_handle, &needs_close, NULL, NULL ))) return res;
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock( &sigset );
 
     res = map_view( &view, base, size, alloc_type & (MEM_TOP_DOWN | MEM_REPLACE_PLACEHOLDER),
                     vprot, get_zero_bits_mask( zero_bits ), 0 );
@@ -2923,7 +3185,7 @@ static unsigned int virtual_map_section( HANDLE handle, PVOID *addr_ptr, ULONG_P
     else delete_view( view );
 
 done:
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock( &sigset );
     if (needs_close) close( unix_handle );
     TRACE("status %#x.\n", res);
     return res;
@@ -2960,6 +3222,58 @@ static int alloc_virtual_heap( void *base, SIZE_T size, void *arg )
     return (alloc->base != MAP_FAILED);
 }
 
+/***********************************************************************
+ *           init_uffd_write_watches
+ *
+ * Check whether the kernel supports asynchronous userfaultfd write protection
+ * together with PAGEMAP_SCAN, so that write watches don't need page faults.
+ */
+static BOOL init_uffd_write_watches(void)
+{
+#ifdef PM_IOC_SCAN
+    const UINT64 features = UFFD_FEATURE_WP_ASYNC | UFFD_FEATURE_WP_UNPOPULATED;
+    struct uffd_api_args api;
+    struct pm_page_region region;
+    struct pm_scan_args scan;
+    int fd;
+
+    if ((fd = syscall( __NR_userfaultfd, O_CLOEXEC | UFFD_USER_MODE_ONLY )) == -1) return FALSE;
+
+    api.api = UFFD_API_VERSION;
+    api.features = features;
+    api.ioctls = 0;
+    if (ioctl( fd, UFFD_IOC_API, &api ) == -1 || (api.features & features) != features)
+    {
+        close( fd );
+        return FALSE;
+    }
+
+    if ((pagemap_fd = open( "/proc/self/pagemap", O_RDONLY | O_CLOEXEC )) == -1)
+    {
+        close( fd );
+        return FALSE;
+    }
+
+    /* an empty scan fails on kernels without PAGEMAP_SCAN */
+    memset( &scan, 0, sizeof(scan) );
+    scan.size = sizeof(scan);
+    scan.vec = (ULONG_PTR)&region;
+    scan.vec_len = 1;
+    if (ioctl( pagemap_fd, PM_IOC_SCAN, &scan ) == -1)
+    {
+        close( pagemap_fd );
+        close( fd );
+        return FALSE;
+    }
+
+    uffd_fd = fd;
+    return TRUE;
+#else
+    return FALSE;
+#endif
+}
+
+
 /***********************************************************************
  *           virtual_init
  */
@@ -2978,8 +3292,16 @@ void virtual_init(void)
     pthread_mutex_init( &virtual_mutex, &attr );
     pthread_mutexattr_destroy( &attr );
 
-    if (!((env_var = getenv("WINE_DISABLE_KERNEL_WRITEWATCH")) && atoi(env_var))
-            && (pagemap_reset_fd = open("/proc/self/pagemap_reset", O_RDONLY)) != -1)
+    if ((env_var = getenv("WINE_DISABLE_KERNEL_WRITEWATCH")) && atoi(env_var))
+        pagemap_reset_fd = -1;
+    else if ((pagemap_reset_fd = open("/proc/self/pagemap_reset", O_RDONLY)) == -1 && init_uffd_write_watches())
+    {
+        use_kernel_writewatch = TRUE;
+        if (ERR_ON(virtual))
+            MESSAGE("wine: using userfaultfd write watches.\n");
+    }
+
+    if (pagemap_reset_fd != -1)
     {
         use_kernel_writewatch = TRUE;
         if ((pagemap_fd = open("/proc/self/pagemap", O_RDONLY)) == -1)
@@ -3160,7 +3482,7 @@ NTSTATUS virtual_create_builtin_view( void *module, const UNICODE_STRING *nt_nam
     void *base = wine_server_get_ptr( info->base );
     int i;
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock( &sigset );
     status = create_view( &view, base, size, SEC_IMAGE | SEC_FILE | VPROT_SYSTEM |
                           VPROT_COMMITTED | VPROT_READ | VPROT_WRITECOPY | VPROT_EXEC );
     if (!status)
@@ -3199,7 +3521,7 @@ NTSTATUS virtual_create_builtin_view( void *module, const UNICODE_STRING *nt_nam
         }
         else delete_view( view );
     }
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock( &sigset );
 
     return status;
 }
@@ -3312,7 +3634,7 @@ NTSTATUS virtual_alloc_teb( TEB **ret_teb )
     SIZE_T block_size = signal_stack_mask + 1;
     BOOL is_wow = !!NtCurrentTeb()->WowTebOffset;
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock( &sigset );
     if (next_free_teb)
     {
         ptr = next_free_teb;
@@ -3328,7 +3650,7 @@ NTSTATUS virtual_alloc_teb( TEB **ret_teb )
             if ((status = NtAllocateVirtualMemory( NtCurrentProcess(), &ptr, is_win64 && is_wow ? 0x7fffffff : 0,
                                                    &total, MEM_RESERVE, PAGE_READWRITE )))
             {
-                server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+                virtual_unlock( &sigset );
                 return status;
             }
             teb_block = ptr;
@@ -3339,14 +3661,14 @@ NTSTATUS virtual_alloc_teb( TEB **ret_teb )
                                  MEM_COMMIT, PAGE_READWRITE );
     }
     *ret_teb = teb = init_teb( ptr, is_wow );
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock( &sigset );
 
     if ((status = signal_alloc_thread( teb )))
     {
-        server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+        virtual_lock( &sigset );
         *(void **)ptr = next_free_teb;
         next_free_teb = ptr;
-        server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+        virtual_unlock( &sigset );
     }
     return status;
 }
@@ -3380,13 +3702,13 @@ void virtual_free_teb( TEB *teb )
         NtFreeVirtualMemory( GetCurrentProcess(), &ptr, &size, MEM_RELEASE );
     }
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock( &sigset );
     list_remove( &thread_data->entry );
     ptr = teb;
     if (!is_win64) ptr = (char *)ptr - teb_offset;
     *(void **)ptr = next_free_teb;
     next_free_teb = ptr;
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock( &sigset );
 }
 
 
@@ -3400,7 +3722,7 @@ NTSTATUS virtual_clear_tls_index( ULONG index )
 
     if (index < TLS_MINIMUM_AVAILABLE)
     {
-        server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+        virtual_lock( &sigset );
         LIST_FOR_EACH_ENTRY( thread_data, &teb_list, struct ntdll_thread_data, entry )
         {
             TEB *teb = CONTAINING_RECORD( (GDI_TEB_BATCH *)thread_data, TEB, GdiTebBatch );
@@ -3411,14 +3733,14 @@ NTSTATUS virtual_clear_tls_index( ULONG index )
 #endif
             teb->TlsSlots[index] = 0;
         }
-        server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+        virtual_unlock( &sigset );
     }
     else
     {
         index -= TLS_MINIMUM_AVAILABLE;
         if (index >= 8 * sizeof(peb->TlsExpansionBitmapBits)) return STATUS_INVALID_PARAMETER;
 
-        server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+        virtual_lock( &sigset );
         LIST_FOR_EACH_ENTRY( thread_data, &teb_list, struct ntdll_thread_data, entry )
         {
             TEB *teb = CONTAINING_RECORD( (GDI_TEB_BATCH *)thread_data, TEB, GdiTebBatch );
@@ -3433,7 +3755,7 @@ NTSTATUS virtual_clear_tls_index( ULONG index )
 #endif
             if (teb->TlsExpansionSlots) teb->TlsExpansionSlots[index] = 0;
         }
-        server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+        virtual_unlock( &sigset );
     }
     return STATUS_SUCCESS;
 }
@@ -3458,7 +3780,7 @@ NTSTATUS virtual_alloc_thread_stack( INITIAL_TEB *stack, ULONG_PTR zero_bits, SI
     if (size < 1024 * 1024) size = 1024 * 1024;  /* Xlib needs a large stack */
     size = (size + 0xffff) & ~0xffff;  /* round to 64K boundary */
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock( &sigset );
 
     if ((status = map_view( &view, NULL, size + extra_size, 0,
                             VPROT_READ | VPROT_WRITE | VPROT_COMMITTED, get_zero_bits_mask( zero_bits ), 0 ))
@@ -3504,7 +3826,7 @@ NTSTATUS virtual_alloc_thread_stack( INITIAL_TEB *stack, ULONG_PTR zero_bits, SI
     stack->StackBase = (char *)view->base + view->size;
     stack->StackLimit = (char *)view->base + 2 * page_size;
 done:
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock( &sigset );
     return status;
 }
 
@@ -3622,7 +3944,7 @@ NTSTATUS virtual_handle_fault( void *addr, DWORD err, void *stack )
     char *page = ROUND_ADDR( addr, page_mask );
     BYTE vprot;
 
-    mutex_lock( &virtual_mutex );  /* no need for signal masking inside signal handler */
+    virtual_mutex_lock();  /* no need for signal masking inside signal handler */
     vprot = get_page_vprot( page );
     if (!is_inside_signal_stack( stack ) && (vprot & VPROT_GUARD))
     {
@@ -3681,7 +4003,7 @@ NTSTATUS virtual_handle_fault( void *addr, DWORD err, void *stack )
         else
             set_page_vprot_bits( page, page_size, 0, VPROT_READ | VPROT_EXEC );
     }
-    mutex_unlock( &virtual_mutex );
+    virtual_mutex_unlock();
     return ret;
 }
 
@@ -3719,14 +4041,14 @@ void *virtual_setup_exception( void *stack_ptr, size_t size, EXCEPTION_RECORD *r
     }
     else if (stack < stack_info.limit)
     {
-        mutex_lock( &virtual_mutex );  /* no need for signal masking inside signal handler */
+        virtual_mutex_lock();  /* no need for signal masking inside signal handler */
         if ((get_page_vprot( stack ) & VPROT_GUARD) &&
             grow_thread_stack( ROUND_ADDR( stack, page_mask ), &stack_info ))
         {
             rec->ExceptionCode = STATUS_STACK_OVERFLOW;
             rec->NumberParameters = 0;
         }
-        mutex_unlock( &virtual_mutex );
+        virtual_mutex_unlock();
     }
 #if defined(VALGRIND_MAKE_MEM_UNDEFINED)
     VALGRIND_MAKE_MEM_UNDEFINED( stack, size );
@@ -3775,14 +4097,14 @@ unsigned int virtual_locked_server_call( void *req_ptr )
 
     if (!size) return wine_server_call( req_ptr );
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock( &sigset );
     if (!(ret = check_write_access( addr, size, &has_write_watch )))
     {
         ret = server_call_unlocked( req );
         if (has_write_watch) update_write_watches( addr, size, wine_server_reply_size( req ));
     }
     else memset( &req->u.reply, 0, sizeof(req->u.reply) );
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock( &sigset );
     return ret;
 }
 
@@ -3799,14 +4121,14 @@ ssize_t virtual_locked_read( int fd, void *addr, size_t size )
     ssize_t ret = read( fd, addr, size );
     if (ret != -1 || errno != EFAULT) return ret;
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock( &sigset );
     if (!check_write_access( addr, size, &has_write_watch ))
     {
         ret = read( fd, addr, size );
         err = errno;
         if (has_write_watch) update_write_watches( addr, size, max( 0, ret ));
     }
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock( &sigset );
     errno = err;
     return ret;
 }
@@ -3824,14 +4146,14 @@ ssize_t virtual_locked_pread( int fd, void *addr, size_t size, off_t offset )
     ssize_t ret = pread( fd, addr, size, offset );
     if (ret != -1 || errno != EFAULT) return ret;
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock( &sigset );
     if (!check_write_access( addr, size, &has_write_watch ))
     {
         ret = pread( fd, addr, size, offset );
         err = errno;
         if (has_write_watch) update_write_watches( addr, size, max( 0, ret ));
     }
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock( &sigset );
     errno = err;
     return ret;
 }
@@ -3850,7 +4172,7 @@ ssize_t virtual_locked_recvmsg( int fd, struct msghdr *hdr, int flags )
     ssize_t ret = recvmsg( fd, hdr, flags );
     if (ret != -1 || errno != EFAULT) return ret;
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock( &sigset );
     for (i = 0; i < hdr->msg_iovlen; i++)
         if (check_write_access( hdr->msg_iov[i].iov_base, hdr->msg_iov[i].iov_len, &has_write_watch ))
             break;
@@ -3862,7 +4184,7 @@ ssize_t virtual_locked_recvmsg( int fd, struct msghdr *hdr, int flags )
     if (has_write_watch)
         while (i--) update_write_watches( hdr->msg_iov[i].iov_base, hdr->msg_iov[i].iov_len, 0 );
 
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock( &sigset );
     errno = err;
     return ret;
 }
@@ -3877,10 +4199,10 @@ BOOL virtual_is_valid_code_address( const void *addr, SIZE_T size )
     BOOL ret = FALSE;
     sigset_t sigset;
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock( &sigset );
     if ((view = find_view( addr, size )))
         ret = !(view->protect & VPROT_SYSTEM);  /* system views are not visible to the app */
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock( &sigset );
     return ret;
 }
 
@@ -3967,7 +4289,7 @@ SIZE_T virtual_uninterrupted_read_memory( const void *addr, void *buffer, SIZE_T
 
     if (!size) return 0;
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock( &sigset );
     if ((view = find_view( addr, size )))
     {
         if (!(view->protect & VPROT_SYSTEM))
@@ -3983,7 +4305,7 @@ SIZE_T virtual_uninterrupted_read_memory( const void *addr, void *buffer, SIZE_T
             }
         }
     }
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock( &sigset );
     return bytes_read;
 }
 
@@ -4003,13 +4325,13 @@ NTSTATUS virtual_uninterrupted_write_memory( void *addr, const void *buffer, SIZ
 
     if (!size) return STATUS_SUCCESS;
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock( &sigset );
     if (!(ret = check_write_access( addr, size, &has_write_watch )))
     {
         memcpy( addr, buffer, size );
         if (has_write_watch) update_write_watches( addr, size, size );
     }
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock( &sigset );
     return ret;
 }
 
@@ -4024,7 +4346,7 @@ void virtual_set_force_exec( BOOL enable )
     struct file_view *view;
     sigset_t sigset;
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock( &sigset );
     if (!force_exec_prot != !enable)  /* change all existing views */
     {
         force_exec_prot = enable;
@@ -4042,7 +4364,7 @@ void virtual_set_force_exec( BOOL enable )
             mprotect_range( view->base, view->size, commit, 0 );
         }
     }
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock( &sigset );
 }
 
 struct free_range
@@ -4203,7 +4525,7 @@ static NTSTATUS allocate_virtual_memory( void **ret, SIZE_T *size_ptr, ULONG typ
 
     /* Reserve the memory */
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock( &sigset );
 
     if ((type & MEM_RESERVE) || !base)
     {
@@ -4251,7 +4573,7 @@ static NTSTATUS allocate_virtual_memory( void **ret, SIZE_T *size_ptr, ULONG typ
         dump_memory_statistics();
     }
 
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock( &sigset );
 
     if (status == STATUS_SUCCESS)
     {
@@ -4467,7 +4789,7 @@ NTSTATUS WINAPI NtFreeVirtualMemory( HANDLE process, PVOID *addr_ptr, SIZE_T *si
     if (size) size = ROUND_SIZE( addr, size );
     base = ROUND_ADDR( addr, page_mask );
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock( &sigset );
 
     /* avoid freeing the DOS area when a broken app passes a NULL pointer */
     if (!base)
@@ -4618,7 +4940,7 @@ NTSTATUS WINAPI NtFreeVirtualMemory( HANDLE process, PVOID *addr_ptr, SIZE_T *si
 
     dump_memory_statistics();
 
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock( &sigset );
     return status;
 }
 
@@ -4672,7 +4994,7 @@ NTSTATUS WINAPI NtProtectVirtualMemory( HANDLE process, PVOID *addr_ptr, SIZE_T
     size = ROUND_SIZE( addr, size );
     base = ROUND_ADDR( addr, page_mask );
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock( &sigset );
 
     if ((view = find_view( base, size )))
     {
@@ -4715,7 +5037,7 @@ NTSTATUS WINAPI NtProtectVirtualMemory( HANDLE process, PVOID *addr_ptr, SIZE_T
 
     if (!status) VIRTUAL_DEBUG_DUMP_VIEW( view );
 
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock( &sigset );
 
     if (status == STATUS_SUCCESS)
     {
@@ -4771,6 +5093,88 @@ static int get_free_mem_state_callback( void *start, SIZE_T size, void *arg )
     return 1;
 }
 
+/* check that the vprot bytes for the range have been allocated */
+static BOOL is_vprot_range_allocated( const char *base, size_t size )
+{
+    if (!size || is_beyond_limit( base, size, address_space_limit )) return FALSE;
+#ifdef _WIN64
+    {
+        size_t i, start = (size_t)base >> page_shift, end = ((size_t)base + size - 1) >> page_shift;
+
+        for (i = start >> pages_vprot_shift; i <= end >> pages_vprot_shift; i++)
+            if (i >= pages_vprot_size || !pages_vprot[i]) return FALSE;
+    }
+#endif
+    return TRUE;
+}
+
+/***********************************************************************
+ *           fill_basic_memory_info_lockless
+ *
+ * Try to fill the info for an address inside a view without taking virtual_mutex.
+ * View structures and vprot directories are never unmapped, so the walk cannot fault;
+ * the lock sequence tells whether the result may be inconsistent and must be discarded.
+ */
+static BOOL fill_basic_memory_info_lockless( char *base, MEMORY_BASIC_INFORMATION *info )
+{
+    struct wine_rb_entry *ptr;
+    struct file_view *view;
+    char *view_base;
+    unsigned int seq, retry, depth, protect;
+    size_t view_size, size;
+    BYTE vprot;
+
+    for (retry = 0; retry < 3; retry++)
+    {
+        if ((seq = __atomic_load_n( &virtual_lock_seq, __ATOMIC_ACQUIRE )) & 1) return FALSE;
+
+        view = NULL;
+        view_base = NULL;
+        view_size = 0;
+        ptr = views_tree.root;
+        for (depth = 0; ptr && depth < 2 * sizeof(void *) * 8; depth++)
+        {
+            struct file_view *entry = WINE_RB_ENTRY_VALUE( ptr, struct file_view, entry );
+
+            view_base = entry->base;
+            view_size = entry->size;
+            if (view_base > base) ptr = ptr->left;
+            else if (view_base + view_size <= base) ptr = ptr->right;
+            else
+            {
+                view = entry;
+                break;
+            }
+        }
+        /* free areas and SEC_RESERVE mappings need the lock */
+        if (!view) return FALSE;
+        protect = view->protect;
+        if (protect & SEC_RESERVE) return FALSE;
+
+        if (is_vprot_range_allocated( base, view_base + view_size - base ))
+        {
+            size = get_vprot_range_size( base, view_base + view_size - base, ~VPROT_WRITEWATCH, &vprot );
+            __atomic_thread_fence( __ATOMIC_ACQUIRE );
+            if (__atomic_load_n( &virtual_lock_seq, __ATOMIC_RELAXED ) == seq)
+            {
+                info->BaseAddress       = base;
+                info->AllocationBase    = view_base;
+                info->RegionSize        = size;
+                info->State             = (vprot & VPROT_COMMITTED) ? MEM_COMMIT : MEM_RESERVE;
+                info->Protect           = (vprot & VPROT_COMMITTED) ? get_win32_prot( vprot, protect ) : 0;
+                info->AllocationProtect = get_win32_prot( protect, protect );
+                if (protect & SEC_IMAGE) info->Type = MEM_IMAGE;
+                else if (protect & (SEC_FILE | SEC_COMMIT)) info->Type = MEM_MAPPED;
+                else info->Type = MEM_PRIVATE;
+                __atomic_add_fetch( &lockless_query_count, 1, __ATOMIC_RELAXED );
+                return TRUE;
+            }
+        }
+        __atomic_add_fetch( &lockless_query_retries, 1, __ATOMIC_RELAXED );
+    }
+    return FALSE;
+}
+
 static unsigned int fill_basic_memory_info( const void *addr, MEMORY_BASIC_INFORMATION *info )
 {
     char *base, *alloc_base = 0, *alloc_end = working_set_limit;
@@ -4782,9 +5186,11 @@ static unsigned int fill_basic_memory_info( const void *addr, MEMORY_BASIC_INFOR
 
     if (is_beyond_limit( base, 1, working_set_limit )) return STATUS_INVALID_PARAMETER;
 
+    if (fill_basic_memory_info_lockless( base, info )) return STATUS_SUCCESS;
+
     /* Find the view containing the address */
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock( &sigset );
     ptr = views_tree.root;
     while (ptr)
     {
@@ -4849,7 +5255,7 @@ static unsigned int fill_basic_memory_info( const void *addr, MEMORY_BASIC_INFOR
         else if (view->protect & (SEC_FILE | SEC_RESERVE | SEC_COMMIT)) info->Type = MEM_MAPPED;
         else info->Type = MEM_PRIVATE;
     }
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock( &sigset );
 
     return STATUS_SUCCESS;
 }
@@ -4959,7 +5365,7 @@ static NTSTATUS get_working_set_ex( HANDLE process, LPCVOID addr,
         if (vmentries == NULL)
             WARN( "couldn't get process vmmap, errno %d\n", errno );
 
-        server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+        virtual_lock( &sigset );
         for (p = info; (UINT_PTR)(p + 1) <= (UINT_PTR)info + len; p++)
         {
              int i;
@@ -4986,7 +5392,7 @@ static NTSTATUS get_working_set_ex( HANDLE process, LPCVOID addr,
                      p->VirtualAttributes.Win32Protection = get_win32_prot( vprot, view->protect );
              }
         }
-        server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+        virtual_unlock( &sigset );
 
         if (vmentries)
             procstat_freevmmap( pstat, vmentries );
@@ -4996,7 +5402,7 @@ static NTSTATUS get_working_set_ex( HANDLE process, LPCVOID addr,
             procstat_close( pstat );
     }
 #else
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock( &sigset );
     if (pagemap_fd == -2)
     {
 #ifdef O_CLOEXEC
@@ -5035,7 +5441,7 @@ static NTSTATUS get_working_set_ex( HANDLE process, LPCVOID addr,
                 p->VirtualAttributes.Win32Protection = get_win32_prot( vprot, view->protect );
         }
     }
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock( &sigset );
 #endif
 
     if (res_len)
@@ -5379,7 +5785,7 @@ static NTSTATUS unmap_view_of_section( HANDLE process, PVOID addr, ULONG flags )
         return status;
     }
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock( &sigset );
     if ((view = find_view( addr, 0 )) && !is_view_valloc( view ))
     {
         if (flags & MEM_PRESERVE_PLACEHOLDER && !(view->protect & VPROT_FROMPLACEHOLDER))
@@ -5398,7 +5804,7 @@ static NTSTATUS unmap_view_of_section( HANDLE process, PVOID addr, ULONG flags )
                 {
                     TRACE( "not freeing in-use builtin %p\n", view->base );
                     builtin->refcount--;
-                    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+                    virtual_unlock( &sigset );
                     return STATUS_SUCCESS;
                 }
             }
@@ -5428,7 +5834,7 @@ static NTSTATUS unmap_view_of_section( HANDLE process, PVOID addr, ULONG flags )
         else FIXME( "failed to unmap %p %x\n", view->base, status );
     }
 done:
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock( &sigset );
     return status;
 }
 
@@ -5572,7 +5978,7 @@ NTSTATUS WINAPI NtFlushVirtualMemory( HANDLE process, LPCVOID *addr_ptr,
         return result.virtual_flush.status;
     }
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock( &sigset );
     if (!(view = find_view( addr, *size_ptr ))) status = STATUS_INVALID_PARAMETER;
     else
     {
@@ -5582,7 +5988,7 @@ NTSTATUS WINAPI NtFlushVirtualMemory( HANDLE process, LPCVOID *addr_ptr,
         if (msync( addr, *size_ptr, MS_ASYNC )) status = STATUS_NOT_MAPPED_DATA;
 #endif
     }
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock( &sigset );
     return status;
 }
 
@@ -5609,7 +6015,7 @@ NTSTATUS WINAPI NtGetWriteWatch( HANDLE process, ULONG flags, PVOID base, SIZE_T
     TRACE( "%p %x %p-%p %p %lu\n", process, (int)flags, base, (char *)base + size,
            addresses, *count );
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock( &sigset );
 
     if (is_write_watch_range( base, size ))
     {
@@ -5617,6 +6023,56 @@ NTSTATUS WINAPI NtGetWriteWatch( HANDLE process, ULONG flags, PVOID base, SIZE_T
         char *addr = base;
         char *end = addr + size;
 
+#ifdef PM_IOC_SCAN
+        if (uffd_fd != -1)
+        {
+            static struct pm_page_region regions[PAGE_FLAGS_BUFFER_LENGTH / 4];
+            struct pm_scan_args scan;
+            unsigned int i;
+            UINT64 page;
+            int ret;
+
+            /* the range may have been remapped since it was registered */
+            if (flags & WRITE_WATCH_FLAG_RESET)
+            {
+                struct uffd_register_args reg;
+
+                reg.range.start = (ULONG_PTR)base;
+                reg.range.len = size;
+                reg.mode = UFFD_REGISTER_MODE_WP;
+                ioctl( uffd_fd, UFFD_IOC_REGISTER, &reg );
+            }
+
+            while (pos < *count && addr < end)
+            {
+                memset( &scan, 0, sizeof(scan) );
+                scan.size = sizeof(scan);
+                scan.flags = (flags & WRITE_WATCH_FLAG_RESET) ? PM_SCAN_WP_MATCHING : 0;
+                scan.start = (ULONG_PTR)addr;
+                scan.end = (ULONG_PTR)end;
+                scan.vec = (ULONG_PTR)regions;
+                scan.vec_len = ARRAY_SIZE(regions);
+                scan.max_pages = *count - pos;
+                scan.category_mask = PM_PAGE_IS_WRITTEN;
+                scan.return_mask = PM_PAGE_IS_WRITTEN;
+
+                if ((ret = ioctl( pagemap_fd, PM_IOC_SCAN, &scan )) == -1)
+                {
+                    ERR("Error scanning pages, error %s.\n", strerror(errno));
+                    status = STATUS_INVALID_ADDRESS;
+                    goto done;
+                }
+                for (i = 0; i < ret; ++i)
+                {
+                    for (page = regions[i].start; page < regions[i].end && pos < *count; page += page_size)
+                        addresses[pos++] = (void *)(ULONG_PTR)page;
+                }
+                if (scan.walk_end <= (ULONG_PTR)addr) break;
+                addr = (char *)(ULONG_PTR)scan.walk_end;
+            }
+        }
+        else
+#endif
         if (use_kernel_writewatch)
         {
             static UINT64 buffer[PAGE_FLAGS_BUFFER_LENGTH];
@@ -5701,7 +6157,7 @@ NTSTATUS WINAPI NtGetWriteWatch( HANDLE process, ULONG flags, PVOID base, SIZE_T
     else status = STATUS_INVALID_PARAMETER;
 
 done:
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock( &sigset );
     return status;
 }
 
@@ -5722,14 +6178,14 @@ NTSTATUS WINAPI NtResetWriteWatch( HANDLE process, PVOID base, SIZE_T size )
 
     if (!size) return STATUS_INVALID_PARAMETER;
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock( &sigset );
 
     if (is_write_watch_range( base, size ))
         reset_write_watches( base, size );
     else
         status = STATUS_INVALID_PARAMETER;
 
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock( &sigset );
     return status;
 }
 
@@ -5850,7 +6306,7 @@ NTSTATUS WINAPI NtAreMappedFilesTheSame(PVOID addr1, PVOID addr2)
 
     TRACE("%p %p\n", addr1, addr2);
 
-    server_enter_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_lock( &sigset );
 
     view1 = find_view( addr1, 0 );
     view2 = find_view( addr2, 0 );
@@ -5874,7 +6330,7 @@ NTSTATUS WINAPI NtAreMappedFilesTheSame(PVOID addr1, PVOID addr2)
         SERVER_END_REQ;
     }
 
-    server_leave_uninterrupted_section( &virtual_mutex, &sigset );
+    virtual_unlock( &sigset );
     return status;
 }
 
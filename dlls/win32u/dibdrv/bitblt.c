@@ -23,6 +23,10 @@
 #endif
 
 #include <assert.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <unistd.h>
 
 #include "ntgdi_private.h"
 #include "dibdrv.h"
@@ -585,6 +589,164 @@ static void mask_rect( dib_info *dst, const RECT *dst_rect, const dib_info *src,
     }
 }
 
+/* Large operations can be split in horizontal bands that run on a few worker threads.
+ * WINE_DIB_THREADS sets the number of workers, WINE_DIB_BAND_THRESHOLD the minimum
+ * number of pixels for an operation to be split. This is disabled by default: the
+ * workers are plain Unix threads, so faults on the bits (write watches, guard pages)
+ * can't be handled there. */
+
+struct band_job
+{
+    void (*proc)( struct band_job *job, const RECT *rect );
+    const struct clipped_rects *clipped_rects;
+    int  top;         /* first row of the operation */
+    int  height;      /* total height of the operation */
+    int  band_count;
+    int  next_band;   /* protected by band_mutex */
+    int  done;        /* protected by band_mutex */
+};
+
+static pthread_mutex_t band_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t band_job_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t band_done_cond = PTHREAD_COND_INITIALIZER;
+static struct band_job *current_band_job;
+static int band_threads;
+static unsigned int band_threshold = 512 * 512;
+
+static void run_band( struct band_job *job, int band )
+{
+    int i, top = job->top + job->height * band / job->band_count;
+    int bottom = job->top + job->height * (band + 1) / job->band_count;
+    RECT rect;
+
+    for (i = 0; i < job->clipped_rects->count; i++)
+    {
+        rect = job->clipped_rects->rects[i];
+        rect.top = max( rect.top, top );
+        rect.bottom = min( rect.bottom, bottom );
+        if (rect.top < rect.bottom) job->proc( job, &rect );
+    }
+}
+
+/* run the next band of the job, band_mutex must be held */
+static BOOL run_next_band( struct band_job *job )
+{
+    int band;
+
+    if (job->next_band == job->band_count) return FALSE;
+    band = job->next_band++;
+    pthread_mutex_unlock( &band_mutex );
+    run_band( job, band );
+    pthread_mutex_lock( &band_mutex );
+    if (++job->done == job->band_count) pthread_cond_signal( &band_done_cond );
+    return TRUE;
+}
+
+static void *band_thread_proc( void *arg )
+{
+    pthread_mutex_lock( &band_mutex );
+    for (;;)
+    {
+        while (!current_band_job || current_band_job->next_band == current_band_job->band_count)
+            pthread_cond_wait( &band_job_cond, &band_mutex );
+        run_next_band( current_band_job );
+    }
+    return NULL;
+}
+
+static void init_band_threads(void)
+{
+    const char *env;
+    pthread_t thread;
+    pthread_attr_t attr;
+    sigset_t sigset, old_sigset;
+    int i, count = 0;
+
+    if ((env = getenv( "WINE_DIB_THREADS" )))
+    {
+        count = atoi( env );
+        /* a negative value means one less than the number of CPUs */
+        if (count < 0) count = sysconf( _SC_NPROCESSORS_ONLN ) - 1;
+        count = min( count, 32 );
+    }
+    if ((env = getenv( "WINE_DIB_BAND_THRESHOLD" ))) band_threshold = strtoul( env, NULL, 0 );
+
+    /* the workers never run Windows code, keep all signals away from them */
+    sigfillset( &sigset );
+    pthread_sigmask( SIG_SETMASK, &sigset, &old_sigset );
+    pthread_attr_init( &attr );
+    pthread_attr_setdetachstate( &attr, PTHREAD_CREATE_DETACHED );
+    for (i = 0; i < count; i++)
+        if (pthread_create( &thread, &attr, band_thread_proc, NULL )) break;
+    pthread_attr_destroy( &attr );
+    pthread_sigmask( SIG_SETMASK, &old_sigset, NULL );
+    band_threads = i;
+    TRACE( "using %d band threads, threshold %u pixels\n", band_threads, band_threshold );
+}
+
+/* split the clipped rectangles in horizontal bands and run the job on each of them */
+static void run_band_job( struct band_job *job, const struct clipped_rects *clipped_rects )
+{
+    static pthread_once_t init_once = PTHREAD_ONCE_INIT;
+    unsigned int area = 0;
+    int i, top = INT_MAX, bottom = INT_MIN;
+
+    job->clipped_rects = clipped_rects;
+    job->band_count = 1;
+    job->next_band = job->done = 0;
+
+    for (i = 0; i < clipped_rects->count; i++)
+    {
+        const RECT *rect = &clipped_rects->rects[i];
+        area += (rect->right - rect->left) * (rect->bottom - rect->top);
+        top = min( top, rect->top );
+        bottom = max( bottom, rect->bottom );
+    }
+    if (!clipped_rects->count) return;
+    job->top = top;
+    job->height = bottom - top;
+
+    pthread_once( &init_once, init_band_threads );
+    if (band_threads && area >= band_threshold)
+        job->band_count = max( 1, min( band_threads + 1, job->height / 16 ));
+
+    if (job->band_count > 1)
+    {
+        pthread_mutex_lock( &band_mutex );
+        if (!current_band_job)
+        {
+            current_band_job = job;
+            pthread_cond_broadcast( &band_job_cond );
+            while (run_next_band( job ));
+            while (job->done < job->band_count) pthread_cond_wait( &band_done_cond, &band_mutex );
+            current_band_job = NULL;
+            pthread_mutex_unlock( &band_mutex );
+            return;
+        }
+        /* the workers are busy with another operation */
+        pthread_mutex_unlock( &band_mutex );
+        job->band_count = 1;
+    }
+    for (i = 0; i < clipped_rects->count; i++) job->proc( job, &clipped_rects->rects[i] );
+}
+
+struct blend_band_job
+{
+    struct band_job job;
+    dib_info       *dst;
+    const dib_info *src;
+    POINT           offset;
+    BLENDFUNCTION   blend;
+};
+
+static void blend_band_proc( struct band_job *job, const RECT *rect )
+{
+    struct blend_band_job *blend_job = CONTAINING_RECORD( job, struct blend_band_job, job );
+
+    blend_job->dst->funcs->blend_rects( blend_job->dst, 1, rect, blend_job->src,
+                                        &blend_job->offset, blend_job->blend );
+}
+
 static DWORD blend_rect( dib_info *dst, const RECT *dst_rect, const dib_info *src, const RECT *src_rect,
                          HRGN clip, BLENDFUNCTION blend )
 {
@@ -595,7 +757,16 @@ static DWORD blend_rect( dib_info *dst, const RECT *dst_rect, const dib_info *sr
 
     offset.x = src_rect->left - dst_rect->left;
     offset.y = src_rect->top  - dst_rect->top;
-    dst->funcs->blend_rects( dst, clipped_rects.count, clipped_rects.rects, src, &offset, blend );
+
+    /* bands would race if they read rows written by another band */
+    if (dst->bits.ptr != src->bits.ptr)
+    {
+        struct blend_band_job job = { .job.proc = blend_band_proc, .dst = dst, .src = src,
+                                      .offset = offset, .blend = blend };
+
+        run_band_job( &job.job, &clipped_rects );
+    }
+    else dst->funcs->blend_rects( dst, clipped_rects.count, clipped_rects.rects, src, &offset, blend );
 
     free_clipped_rects( &clipped_rects );
     return ERROR_SUCCESS;
@@ -680,19 +851,34 @@ static void get_gradient_triangle_vertices( const GRADIENT_TRIANGLE *tri, const
     bounds->bottom = v[2].y;
 }
 
+struct gradient_band_job
+{
+    struct band_job job;
+    dib_info       *dib;
+    const TRIVERTEX *v;
+    int             mode;
+    BOOL            failed;
+};
+
+static void gradient_band_proc( struct band_job *job, const RECT *rect )
+{
+    struct gradient_band_job *gradient_job = CONTAINING_RECORD( job, struct gradient_band_job, job );
+
+    /* failure only depends on the vertices, so all bands agree on it */
+    if (gradient_job->failed) return;
+    if (!gradient_job->dib->funcs->gradient_rect( gradient_job->dib, rect, gradient_job->v, gradient_job->mode ))
+        gradient_job->failed = TRUE;
+}
+
 static BOOL gradient_rect( dib_info *dib, TRIVERTEX *v, int mode, HRGN clip, const RECT *bounds )
 {
-    int i;
     struct clipped_rects clipped_rects;
-    BOOL ret = TRUE;
+    struct gradient_band_job job = { .job.proc = gradient_band_proc, .dib = dib, .v = v, .mode = mode };
 
     if (!get_clipped_rects( dib, bounds, clip, &clipped_rects )) return TRUE;
-    for (i = 0; i < clipped_rects.count; i++)
-    {
-        if (!(ret = dib->funcs->gradient_rect( dib, &clipped_rects.rects[i], v, mode ))) break;
-    }
+    run_band_job( &job.job, &clipped_rects );
     free_clipped_rects( &clipped_rects );
-    return ret;
+    return !job.failed;
 }
 
 static DWORD copy_src_bits( dib_info *src, RECT *src_rect )
@@ -46,6 +46,7 @@ enum glyph_type
 
 #define GLYPH_CACHE_PAGE_SIZE  0x100
 #define GLYPH_CACHE_PAGES      (0x10000 / GLYPH_CACHE_PAGE_SIZE)
+#define GLYPH_CACHE_MAX_SIZE   (16 * 1024 * 1024)  /* glyph bytes before unused fonts get freed */
 
 struct cached_font
 {
@@ -55,10 +56,12 @@ struct cached_font
     LOGFONTW              lf;
     XFORM                 xform;
     UINT                  aa_flags;
+    LONG                  size;      /* total size of the cached glyphs */
     struct cached_glyph **glyphs[GLYPH_NBTYPES][GLYPH_CACHE_PAGES];
 };
 
 static struct list font_cache = LIST_INIT( font_cache );
+static LONG glyph_cache_hits, glyph_cache_misses;
 
 static pthread_mutex_t font_cache_lock = PTHREAD_MUTEX_INITIALIZER;
 
@@ -631,10 +634,50 @@ static int font_cache_cmp( const struct cached_font *p1, const struct cached_fon
     return ret;
 }
 
+static void free_cached_font_glyphs( struct cached_font *font )
+{
+    UINT i, j, k;
+
+    for (i = 0; i < GLYPH_NBTYPES; i++)
+    {
+        for (j = 0; j < GLYPH_CACHE_PAGES; j++)
+        {
+            if (!font->glyphs[i][j]) continue;
+            for (k = 0; k < GLYPH_CACHE_PAGE_SIZE; k++)
+                free( font->glyphs[i][j][k] );
+            free( font->glyphs[i][j] );
+        }
+    }
+}
+
+/* free the least recently used unreferenced fonts until the glyphs fit in the cache
+ * size limit, font_cache_lock must be held */
+static void trim_font_cache( SIZE_T size )
+{
+    struct cached_font *font, *next;
+    UINT count = 0;
+
+    LIST_FOR_EACH_ENTRY( font, &font_cache, struct cached_font, entry ) size += font->size;
+
+    LIST_FOR_EACH_ENTRY_SAFE_REV( font, next, &font_cache, struct cached_font, entry )
+    {
+        if (size <= GLYPH_CACHE_MAX_SIZE) break;
+        if (font->ref) continue;
+        size -= font->size;
+        list_remove( &font->entry );
+        free_cached_font_glyphs( font );
+        free( font );
+        count++;
+    }
+
+    TRACE( "%u glyph bytes, %u fonts freed, %d hits, %d misses\n", (UINT)size, count,
+           (int)glyph_cache_hits, (int)glyph_cache_misses );
+}
+
 static struct cached_font *add_cached_font( DC *dc, HFONT hfont, UINT aa_flags )
 {
     struct cached_font font, *ptr, *last_unused = NULL;
-    UINT i = 0, j, k;
+    UINT i = 0;
 
     NtGdiExtGetObjectW( hfont, sizeof(font.lf), &font.lf );
     font.xform = dc->xformWorld2Vport;
@@ -668,16 +711,7 @@ static struct cached_font *add_cached_font( DC *dc, HFONT hfont, UINT aa_flags )
     if (i > 5)  /* keep at least 5 of the most-recently used fonts around */
     {
         ptr = last_unused;
-        for (i = 0; i < GLYPH_NBTYPES; i++)
-        {
-            for (j = 0; j < GLYPH_CACHE_PAGES; j++)
-            {
-                if (!ptr->glyphs[i][j]) continue;
-                for (k = 0; k < GLYPH_CACHE_PAGE_SIZE; k++)
-                    free( ptr->glyphs[i][j][k] );
-                free( ptr->glyphs[i][j] );
-            }
-        }
+        free_cached_font_glyphs( ptr );
         list_remove( &ptr->entry );
     }
     else if (!(ptr = malloc( sizeof(*ptr) )))
@@ -688,8 +722,10 @@ static struct cached_font *add_cached_font( DC *dc, HFONT hfont, UINT aa_flags )
 
     *ptr = font;
     ptr->ref = 1;
+    ptr->size = 0;
     memset( ptr->glyphs, 0, sizeof(ptr->glyphs) );
 done:
+    trim_font_cache( ptr->size );
     list_add_head( &font_cache, &ptr->entry );
     pthread_mutex_unlock( &font_cache_lock );
     TRACE( "%d %s -> %p\n", (int)ptr->lf.lfHeight, debugstr_w(ptr->lf.lfFaceName), ptr );
@@ -702,7 +738,7 @@ void release_cached_font( struct cached_font *font )
 }
 
 static struct cached_glyph *add_cached_glyph( struct cached_font *font, UINT index, UINT flags,
-                                              struct cached_glyph *glyph )
+                                              struct cached_glyph *glyph, SIZE_T size )
 {
     struct cached_glyph *ret;
     enum glyph_type type = (flags & ETO_GLYPH_INDEX) ? GLYPH_INDEX : GLYPH_WCHAR;
@@ -723,7 +759,11 @@ static struct cached_glyph *add_cached_glyph( struct cached_font *font, UINT ind
             free( ptr );
     }
     ret = InterlockedCompareExchangePointer( (void **)&font->glyphs[type][page][entry], glyph, NULL );
-    if (!ret) ret = glyph;
+    if (!ret)
+    {
+        InterlockedExchangeAdd( &font->size, size );
+        ret = glyph;
+    }
     else free( glyph );
     return ret;
 }
@@ -884,7 +924,7 @@ static struct cached_glyph *cache_glyph_bitmap( DC *dc, struct cached_font *font
 
 done:
     glyph->metrics = metrics;
-    return add_cached_glyph( font, index, flags, glyph );
+    return add_cached_glyph( font, index, flags, glyph, FIELD_OFFSET( struct cached_glyph, bits[size] ));
 }
 
 static void render_string( DC *dc, dib_info *dib, struct cached_font *font, INT x, INT y,
@@ -912,8 +952,15 @@ static void render_string( DC *dc, dib_info *dib, struct cached_font *font, INT
 
     for (i = 0; i < count; i++)
     {
-        if (!(glyph = get_cached_glyph( font, str[i], flags )) &&
-            !(glyph = cache_glyph_bitmap( dc, font, str[i], flags ))) continue;
+        if ((glyph = get_cached_glyph( font, str[i], flags )))
+        {
+            if (TRACE_ON(dib)) InterlockedIncrement( &glyph_cache_hits );
+        }
+        else
+        {
+            if (TRACE_ON(dib)) InterlockedIncrement( &glyph_cache_misses );
+            if (!(glyph = cache_glyph_bitmap( dc, font, str[i], flags ))) continue;
+        }
 
         glyph_dib.width       = glyph->metrics.gmBlackBoxX;
         glyph_dib.height      = glyph->metrics.gmBlackBoxY;
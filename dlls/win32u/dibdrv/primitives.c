@@ -23,6 +23,9 @@
 #endif
 
 #include <assert.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "ntgdi_private.h"
 #include "dibdrv.h"
@@ -4682,6 +4685,84 @@ static inline DWORD blend_rgb( BYTE dst_r, BYTE dst_g, BYTE dst_b, DWORD src, BL
             blend_color( dst_r, src >> 16, blend.SourceConstantAlpha ) << 16);
 }
 
+#ifdef __SSE2__
+
+/* exact (x + 127) / 255 for 16-bit lanes holding values up to 255 * 255 */
+static inline __m128i div255_epu16( __m128i x )
+{
+    x = _mm_add_epi16( x, _mm_set1_epi16( 127 ) );
+    return _mm_srli_epi16( _mm_add_epi16( _mm_add_epi16( x, _mm_set1_epi16( 1 ) ), _mm_srli_epi16( x, 8 ) ), 8 );
+}
+
+/* same as blend_argb() on two pixels unpacked to 16-bit channels */
+static inline __m128i blend_argb_epu16( __m128i dst, __m128i src )
+{
+    __m128i alpha = _mm_shufflehi_epi16( _mm_shufflelo_epi16( src, 0xff ), 0xff );
+    __m128i inv_alpha = _mm_sub_epi16( _mm_set1_epi16( 255 ), alpha );
+
+    return _mm_add_epi16( src, div255_epu16( _mm_mullo_epi16( dst, inv_alpha ) ));
+}
+
+/* same as blend_argb_constant_alpha() on two pixels unpacked to 16-bit channels */
+static inline __m128i blend_argb_constant_alpha_epu16( __m128i dst, __m128i src, __m128i alpha )
+{
+    __m128i inv_alpha = _mm_sub_epi16( _mm_set1_epi16( 255 ), alpha );
+
+    return div255_epu16( _mm_add_epi16( _mm_mullo_epi16( src, alpha ), _mm_mullo_epi16( dst, inv_alpha ) ));
+}
+
+#endif
+
+static void blend_argb_row( DWORD *dst, const DWORD *src, int len )
+{
+    int x = 0;
+
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128(), max = _mm_set1_epi16( 255 );
+
+    for (; x + 4 <= len; x += 4)
+    {
+        __m128i s = _mm_loadu_si128( (const __m128i *)(src + x) );
+        __m128i d = _mm_loadu_si128( (const __m128i *)(dst + x) );
+        __m128i lo = blend_argb_epu16( _mm_unpacklo_epi8( d, zero ), _mm_unpacklo_epi8( s, zero ) );
+        __m128i hi = blend_argb_epu16( _mm_unpackhi_epi8( d, zero ), _mm_unpackhi_epi8( s, zero ) );
+
+        /* with non-premultiplied source a channel can overflow into the next one,
+         * leave those pixels to the scalar code to get identical results */
+        if (_mm_movemask_epi8( _mm_cmpgt_epi16( _mm_or_si128( lo, hi ), max ) ))
+        {
+            int i;
+            for (i = x; i < x + 4; i++) dst[i] = blend_argb( dst[i], src[i] );
+            continue;
+        }
+        _mm_storeu_si128( (__m128i *)(dst + x), _mm_packus_epi16( lo, hi ) );
+    }
+#endif
+    for (; x < len; x++) dst[x] = blend_argb( dst[x], src[x] );
+}
+
+static void blend_argb_constant_alpha_row( DWORD *dst, const DWORD *src, int len, DWORD alpha )
+{
+    int x = 0;
+
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128(), alpha_epu16 = _mm_set1_epi16( alpha );
+
+    for (; x + 4 <= len; x += 4)
+    {
+        __m128i s = _mm_loadu_si128( (const __m128i *)(src + x) );
+        __m128i d = _mm_loadu_si128( (const __m128i *)(dst + x) );
+        __m128i lo = blend_argb_constant_alpha_epu16( _mm_unpacklo_epi8( d, zero ),
+                                                      _mm_unpacklo_epi8( s, zero ), alpha_epu16 );
+        __m128i hi = blend_argb_constant_alpha_epu16( _mm_unpackhi_epi8( d, zero ),
+                                                      _mm_unpackhi_epi8( s, zero ), alpha_epu16 );
+
+        _mm_storeu_si128( (__m128i *)(dst + x), _mm_packus_epi16( lo, hi ) );
+    }
+#endif
+    for (; x < len; x++) dst[x] = blend_argb_constant_alpha( dst[x], src[x], alpha );
+}
+
 static void blend_rects_8888(const dib_info *dst, int num, const RECT *rc,
                              const dib_info *src, const POINT *offset, BLENDFUNCTION blend)
 {
@@ -4696,8 +4777,7 @@ static void blend_rects_8888(const dib_info *dst, int num, const RECT *rc,
         {
             if (blend.SourceConstantAlpha == 255)
                 for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-                    for (x = 0; x < rc->right - rc->left; x++)
-                        dst_ptr[x] = blend_argb( dst_ptr[x], src_ptr[x] );
+                    blend_argb_row( dst_ptr, src_ptr, rc->right - rc->left );
             else
                 for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
                     for (x = 0; x < rc->right - rc->left; x++)
@@ -4705,8 +4785,7 @@ static void blend_rects_8888(const dib_info *dst, int num, const RECT *rc,
         }
         else if (src->compression == BI_RGB)
             for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-                for (x = 0; x < rc->right - rc->left; x++)
-                    dst_ptr[x] = blend_argb_constant_alpha( dst_ptr[x], src_ptr[x], blend.SourceConstantAlpha );
+                blend_argb_constant_alpha_row( dst_ptr, src_ptr, rc->right - rc->left, blend.SourceConstantAlpha );
         else
             for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
                 for (x = 0; x < rc->right - rc->left; x++)
@@ -1309,15 +1309,280 @@ static void unix_face_destroy( struct unix_face *This )
     free( This );
 }
 
+/* Font file cache
+ *
+ * Parsing every font file is the main cost of the font initialization of each process.
+ * While the system fonts are loaded, the parsed faces are recorded along with the file
+ * size and modification time, and the result is stored in a single volatile registry
+ * value. Other processes of the session then only need to stat the files.
+ */
+
+#define FILE_CACHE_VERSION 1
+
+struct file_cache_header
+{
+    DWORD version;
+    DWORD lcid;
+};
+
+struct file_cache_face
+{
+    DWORD               record_size;   /* size of the record including the strings, 8-byte aligned */
+    DWORD               face_index;
+    DWORD               allow_bitmap;
+    DWORD               num_faces;     /* 0 if the file couldn't be parsed */
+    DWORD               scalable;
+    DWORD               ntm_flags;
+    DWORD               font_version;
+    DWORD               names;         /* mask of the names that are present */
+    FONTSIGNATURE       fs;
+    struct bitmap_font_size size;
+    ULONGLONG           file_size;
+    ULONGLONG           mtime;
+    ULONGLONG           inode;
+    char                unix_name[1];
+    /* followed by the family, second, style and full names, WCHAR aligned */
+};
+
+static const WCHAR file_cache_keyW[] =
+    {'S','o','f','t','w','a','r','e','\\','W','i','n','e','\\','F','o','n','t','s','\\',
+     'F','i','l','e','C','a','c','h','e'};
+
+static BOOL file_cache_active;     /* recording faces while the system fonts are loaded */
+static char *file_cache;           /* cache loaded from the registry */
+static SIZE_T file_cache_size, file_cache_pos;
+static UINT file_cache_count, file_cache_hits, file_cache_misses;
+static char *new_file_cache;       /* cache built by this process */
+static SIZE_T new_file_cache_size, new_file_cache_alloc;
+
+static HKEY open_file_cache_key(void)
+{
+    return reg_create_key( hkcu_key, file_cache_keyW, sizeof(file_cache_keyW), REG_OPTION_VOLATILE, NULL );
+}
+
+static void load_file_cache(void)
+{
+    const struct file_cache_header *header;
+    KEY_VALUE_PARTIAL_INFORMATION header_info, *info;
+    UNICODE_STRING name = { 0 };
+    const char *ptr, *end;
+    ULONG size = 0;
+    HKEY hkey;
+
+    if (!(hkey = open_file_cache_key())) return;
+    if (NtQueryValueKey( hkey, &name, KeyValuePartialInformation, &header_info, sizeof(header_info),
+                         &size ) == STATUS_BUFFER_OVERFLOW &&
+        (info = malloc( size )))
+    {
+        if (!NtQueryValueKey( hkey, &name, KeyValuePartialInformation, info, size, &size ) &&
+            info->Type == REG_BINARY && info->DataLength >= sizeof(*header))
+        {
+            header = (const struct file_cache_header *)info->Data;
+            if (header->version == FILE_CACHE_VERSION && header->lcid == system_lcid &&
+                (file_cache = malloc( info->DataLength - sizeof(*header) )))
+            {
+                file_cache_size = info->DataLength - sizeof(*header);
+                memcpy( file_cache, header + 1, file_cache_size );
+            }
+        }
+        free( info );
+    }
+    NtClose( hkey );
+
+    /* validate the records so that lookups don't have to */
+    for (ptr = file_cache, end = file_cache + file_cache_size; ptr < end; ptr += ((const DWORD *)ptr)[0])
+    {
+        const struct file_cache_face *face = (const struct file_cache_face *)ptr;
+
+        if (end - ptr < sizeof(*face) || face->record_size < sizeof(*face) ||
+            face->record_size % 8 || face->record_size > end - ptr ||
+            ((const WCHAR *)(ptr + face->record_size))[-1])
+        {
+            WARN( "invalid font file cache\n" );
+            free( file_cache );
+            file_cache = NULL;
+            file_cache_size = file_cache_count = 0;
+            return;
+        }
+        file_cache_count++;
+    }
+    TRACE( "loaded %u cached faces\n", file_cache_count );
+}
+
+static void save_file_cache(void)
+{
+    struct file_cache_header *header;
+    char *buffer;
+    HKEY hkey;
+
+    TRACE( "%u hits, %u misses\n", file_cache_hits, file_cache_misses );
+    if (!file_cache_misses && file_cache_hits == file_cache_count) return;
+
+    if (!(buffer = malloc( sizeof(*header) + new_file_cache_size ))) return;
+    header = (struct file_cache_header *)buffer;
+    header->version = FILE_CACHE_VERSION;
+    header->lcid = system_lcid;
+    memcpy( header + 1, new_file_cache, new_file_cache_size );
+    if ((hkey = open_file_cache_key()))
+    {
+        set_reg_value( hkey, NULL, REG_BINARY, buffer, sizeof(*header) + new_file_cache_size );
+        NtClose( hkey );
+    }
+    free( buffer );
+}
+
+static const struct file_cache_face *find_file_cache_face( const char *unix_name, const struct stat *st,
+                                                           DWORD face_index, DWORD allow_bitmap )
+{
+    SIZE_T pos = file_cache_pos;
+
+    if (!file_cache_size) return NULL;
+
+    /* files are usually loaded in the same order as they were cached, start after the last match */
+    do
+    {
+        const struct file_cache_face *face = (const struct file_cache_face *)(file_cache + pos);
+
+        pos += face->record_size;
+        if (pos == file_cache_size) pos = 0;
+        if (face->face_index == face_index && face->allow_bitmap == allow_bitmap &&
+            !strcmp( face->unix_name, unix_name ))
+        {
+            if (face->file_size != st->st_size || face->mtime != st->st_mtime || face->inode != st->st_ino)
+                return NULL;
+            file_cache_pos = pos;
+            return face;
+        }
+    } while (pos != file_cache_pos);
+
+    return NULL;
+}
+
+static const WCHAR *next_file_cache_name( const WCHAR **ptr, DWORD names, int i )
+{
+    const WCHAR *ret = *ptr;
+
+    if (!(names & (1 << i))) return NULL;
+    *ptr += lstrlenW( ret ) + 1;
+    return ret;
+}
+
+static struct unix_face *unix_face_create_from_cache( const struct file_cache_face *face, DWORD *num_faces )
+{
+    const WCHAR *ptr = (const WCHAR *)(face->unix_name + ((strlen( face->unix_name ) + 2) & ~1));
+    const WCHAR *name;
+    struct unix_face *This;
+
+    *num_faces = face->num_faces;
+    if (!face->num_faces || !(This = calloc( 1, sizeof(*This) ))) return NULL;
+
+    This->scalable     = face->scalable;
+    This->num_faces    = face->num_faces;
+    This->ntm_flags    = face->ntm_flags;
+    This->font_version = face->font_version;
+    This->fs           = face->fs;
+    This->size         = face->size;
+    if ((name = next_file_cache_name( &ptr, face->names, 0 ))) This->family_name = wcsdup( name );
+    if ((name = next_file_cache_name( &ptr, face->names, 1 ))) This->second_name = wcsdup( name );
+    if ((name = next_file_cache_name( &ptr, face->names, 2 ))) This->style_name = wcsdup( name );
+    if ((name = next_file_cache_name( &ptr, face->names, 3 ))) This->full_name = wcsdup( name );
+    return This;
+}
+
+static void append_file_cache_face( const struct file_cache_face *face )
+{
+    if (new_file_cache_size + face->record_size > new_file_cache_alloc)
+    {
+        SIZE_T alloc = max( new_file_cache_alloc * 2, new_file_cache_size + face->record_size + 0x10000 );
+        char *ptr;
+
+        if (!(ptr = realloc( new_file_cache, alloc ))) return;
+        new_file_cache = ptr;
+        new_file_cache_alloc = alloc;
+    }
+    memcpy( new_file_cache + new_file_cache_size, face, face->record_size );
+    new_file_cache_size += face->record_size;
+}
+
+static void add_file_cache_face( const char *unix_name, const struct stat *st, DWORD face_index,
+                                 DWORD allow_bitmap, const struct unix_face *unix_face )
+{
+    const WCHAR *names[4] = { NULL };
+    struct file_cache_face *face;
+    SIZE_T size, name_len = (strlen( unix_name ) + 2) & ~1;
+    WCHAR *ptr;
+    int i;
+
+    if (unix_face)
+    {
+        names[0] = unix_face->family_name;
+        names[1] = unix_face->second_name;
+        names[2] = unix_face->style_name;
+        names[3] = unix_face->full_name;
+    }
+    size = FIELD_OFFSET( struct file_cache_face, unix_name[name_len] );
+    for (i = 0; i < ARRAY_SIZE(names); i++) if (names[i]) size += (lstrlenW( names[i] ) + 1) * sizeof(WCHAR);
+    /* keep the last character of the record zero, load_file_cache checks it */
+    size = (size + sizeof(WCHAR) + 7) & ~7;
+
+    if (!(face = calloc( 1, size ))) return;
+    face->record_size  = size;
+    face->face_index   = face_index;
+    face->allow_bitmap = allow_bitmap;
+    face->file_size    = st->st_size;
+    face->mtime        = st->st_mtime;
+    face->inode        = st->st_ino;
+    strcpy( face->unix_name, unix_name );
+    if (unix_face)
+    {
+        face->num_faces    = unix_face->num_faces;
+        face->scalable     = unix_face->scalable;
+        face->ntm_flags    = unix_face->ntm_flags;
+        face->font_version = unix_face->font_version;
+        face->fs           = unix_face->fs;
+        face->size         = unix_face->size;
+    }
+    ptr = (WCHAR *)(face->unix_name + name_len);
+    for (i = 0; i < ARRAY_SIZE(names); i++)
+    {
+        if (!names[i]) continue;
+        face->names |= 1 << i;
+        lstrcpyW( ptr, names[i] );
+        ptr += lstrlenW( names[i] ) + 1;
+    }
+    append_file_cache_face( face );
+    free( face );
+}
+
 static int add_unix_face( const char *unix_name, const WCHAR *file, void *data_ptr, SIZE_T data_size,
                           DWORD face_index, DWORD flags, DWORD *num_faces )
 {
     struct unix_face *unix_face;
+    struct stat st;
     int ret;
 
     if (num_faces) *num_faces = 0;
 
-    if (!(unix_face = unix_face_create( unix_name, data_ptr, data_size, face_index, flags )))
+    if (file_cache_active && unix_name && !stat( unix_name, &st ))
+    {
+        DWORD allow_bitmap = !!(flags & ADDFONT_ALLOW_BITMAP), count;
+        const struct file_cache_face *face;
+
+        if ((face = find_file_cache_face( unix_name, &st, face_index, allow_bitmap )))
+        {
+            file_cache_hits++;
+            append_file_cache_face( face );
+            unix_face = unix_face_create_from_cache( face, &count );
+        }
+        else
+        {
+            file_cache_misses++;
+            unix_face = unix_face_create( unix_name, data_ptr, data_size, face_index, flags );
+            add_file_cache_face( unix_name, &st, face_index, allow_bitmap, unix_face );
+        }
+        if (!unix_face) return 0;
+    }
+    else if (!(unix_face = unix_face_create( unix_name, data_ptr, data_size, face_index, flags )))
         return 0;
 
     if (unix_face->family_name[0] == '.') /* Ignore fonts with names beginning with a dot */
@@ -1907,6 +2172,14 @@ static void freetype_load_fonts(void)
 #elif defined(__ANDROID__)
     ReadFontDir("/system/fonts", TRUE);
 #endif
+
+    /* the system fonts are loaded, fonts added later are not cached */
+    file_cache_active = FALSE;
+    save_file_cache();
+    free( file_cache );
+    free( new_file_cache );
+    file_cache = new_file_cache = NULL;
+    file_cache_size = new_file_cache_size = new_file_cache_alloc = 0;
 }
 
 /* Some fonts have large usWinDescent values, as a result of storing signed short
@@ -4280,6 +4553,8 @@ const struct font_backend_funcs *init_freetype_lib(void)
     init_fontconfig();
 #endif
     NtQueryDefaultLocale( FALSE, &system_lcid );
+    load_file_cache();
+    file_cache_active = TRUE;
     return &font_funcs;
 }
 
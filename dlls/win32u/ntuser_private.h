@@ -267,6 +267,7 @@ extern volatile struct global_shared_memory *get_global_shared_memory( void ) DE
 extern volatile struct desktop_shared_memory *get_desktop_shared_memory( void ) DECLSPEC_HIDDEN;
 extern volatile struct queue_shared_memory *get_queue_shared_memory( void ) DECLSPEC_HIDDEN;
 extern volatile struct input_shared_memory *get_input_shared_memory( void ) DECLSPEC_HIDDEN;
+extern volatile struct window_shared_memory *get_window_shared_memory( HWND hwnd ) DECLSPEC_HIDDEN;
 extern volatile struct input_shared_memory *get_foreground_shared_memory( void ) DECLSPEC_HIDDEN;
 
 static inline UINT win_get_flags( HWND hwnd )
@@ -346,6 +346,30 @@ DWORD get_window_thread( HWND hwnd, DWORD *process )
     return tid;
 }
 
+/* retrieve the state of a window of another process from the shared memory */
+static BOOL get_shared_window_state( HWND hwnd, struct window_shared_memory *state )
+{
+    volatile struct window_shared_memory *shared = get_window_shared_memory( hwnd );
+    user_handle_t handle = wine_server_user_handle( hwnd );
+
+    if (!shared) return FALSE;
+
+    SHARED_READ_BEGIN( &shared->seq )
+    {
+        state->handle   = shared->handle;
+        state->parent   = shared->parent;
+        state->owner    = shared->owner;
+        state->style    = shared->style;
+        state->ex_style = shared->ex_style;
+        state->id       = shared->id;
+    }
+    SHARED_READ_END( &shared->seq );
+
+    if (!state->handle || LOWORD(handle) != LOWORD(state->handle)) return FALSE;
+    /* the generation may be omitted, as for get_full_window_handle */
+    return handle == state->handle || !HIWORD(handle) || HIWORD(handle) == 0xffff;
+}
+
 /* see GetParent */
 HWND get_parent( HWND hwnd )
 {
@@ -360,7 +384,17 @@ HWND get_parent( HWND hwnd )
     if (win == WND_DESKTOP) return 0;
     if (win == WND_OTHER_PROCESS)
     {
-        LONG style = get_window_long( hwnd, GWL_STYLE );
+        struct window_shared_memory state;
+        LONG style;
+
+        if (get_shared_window_state( hwnd, &state ))
+        {
+            if (state.style & WS_POPUP) retval = wine_server_ptr_handle( state.owner );
+            else if (state.style & WS_CHILD) retval = wine_server_ptr_handle( state.parent );
+            return retval;
+        }
+
+        style = get_window_long( hwnd, GWL_STYLE );
         if (style & (WS_POPUP | WS_CHILD))
         {
             SERVER_START_REQ( get_window_tree )
@@ -554,15 +588,24 @@ static HWND *list_window_parents( HWND hwnd )
     for (;;)
     {
         if (!(win = get_win_ptr( current ))) goto empty;
-        if (win == WND_OTHER_PROCESS) break;  /* need to do it the hard way */
-        if (win == WND_DESKTOP)
+        if (win == WND_OTHER_PROCESS)
+        {
+            struct window_shared_memory state;
+
+            if (!get_shared_window_state( current, &state )) break;  /* need to do it the hard way */
+            list[pos] = current = wine_server_ptr_handle( state.parent );
+        }
+        else if (win == WND_DESKTOP)
         {
             if (!pos) goto empty;
             list[pos] = 0;
             return list;
         }
-        list[pos] = current = win->parent;
-        release_win_ptr( win );
+        else
+        {
+            list[pos] = current = win->parent;
+            release_win_ptr( win );
+        }
         if (!current) return list;
         if (++pos == size - 1)
         {
@@ -1044,11 +1087,20 @@ static LONG_PTR get_window_long_size( HWND hwnd, INT offset, UINT size, BOOL ans
 
     if (win == WND_OTHER_PROCESS)
     {
+        struct window_shared_memory state;
+
         if (offset == GWLP_WNDPROC)
         {
             RtlSetLastWin32Error( ERROR_ACCESS_DENIED );
             return 0;
         }
+        if ((offset == GWL_STYLE || offset == GWL_EXSTYLE || offset == GWLP_ID) &&
+            get_shared_window_state( hwnd, &state ))
+        {
+            if (offset == GWL_STYLE) return state.style;
+            if (offset == GWL_EXSTYLE) return state.ex_style;
+            return state.id;
+        }
         SERVER_START_REQ( set_window_info )
         {
             req->handle = wine_server_user_handle( hwnd );
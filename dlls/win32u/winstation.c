@@ -783,6 +783,41 @@ volatile struct input_shared_memory *get_foreground_shared_memory( void )
     return get_thread_input_shared_memory( tid, &thread_info->foreground_shared_memory );
 }
 
+volatile struct window_shared_memory *get_window_shared_memory( HWND hwnd )
+{
+    static const WCHAR windows_mappingW[] =
+    {
+        '\\','K','e','r','n','e','l','O','b','j','e','c','t','s','\\',
+        '_','_','w','i','n','e','_','w','i','n','d','o','w','_','m','a','p','p','i','n','g','s','\\',
+        'w','i','n','d','o','w','s',0
+    };
+    static struct window_shared_memory *windows_shared;
+    static BOOL mapping_failed;
+    struct window_shared_memory *ret;
+    UINT index = (LOWORD(hwnd) - FIRST_USER_HANDLE) >> 1;
+
+    if (index >= SHARED_WINDOWS_COUNT) return NULL;
+
+    __WINE_ATOMIC_LOAD_RELAXED( &windows_shared, &ret );
+    if (!ret)
+    {
+        if (mapping_failed) return NULL;
+        map_shared_memory_section( windows_mappingW, SHARED_WINDOWS_COUNT * sizeof(*ret), NULL, (void **)&ret );
+        if (!ret)
+        {
+            mapping_failed = TRUE;
+            return NULL;
+        }
+        if (InterlockedCompareExchangePointer( (void **)&windows_shared, ret, NULL ))
+        {
+            if (NtUnmapViewOfSection( GetCurrentProcess(), ret ))
+                ERR( "NtUnmapViewOfSection failed.\n" );
+            ret = windows_shared;
+        }
+    }
+    return &ret[index];
+}
+
 /***********************************************************************
  *           winstation_init
  *
@@ -90,6 +90,49 @@ static inline float to_sRGB_component(float f)
     return 1.055f * powf(f, 1.0f/2.4f) - 0.055f;
 }
 
+static inline BYTE to_sRGB_byte(float f)
+{
+    return (BYTE)floorf(to_sRGB_component(f) * 255.0f + 0.51f);
+}
+
+/* smallest linear value in [0, 1] that is encoded as each sRGB byte value */
+static float sRGB_thresholds[256];
+static INIT_ONCE sRGB_init_once = INIT_ONCE_STATIC_INIT;
+
+static BOOL WINAPI init_sRGB_thresholds(INIT_ONCE *once, void *param, void **context)
+{
+    UINT lo, hi, mid, i;
+    float f;
+
+    /* the encoding is monotonic, and so are the bit patterns of non-negative floats */
+    for (i = 1; i < 256; i++)
+    {
+        lo = 0;
+        hi = 0x3f800001; /* one past 1.0f */
+        while (lo < hi)
+        {
+            mid = lo + (hi - lo) / 2;
+            memcpy(&f, &mid, sizeof(f));
+            if (to_sRGB_byte(f) >= i) hi = mid;
+            else lo = mid + 1;
+        }
+        if (lo == 0x3f800001) sRGB_thresholds[i] = 2.0f;
+        else memcpy(&sRGB_thresholds[i], &lo, sizeof(f));
+    }
+    return TRUE;
+}
+
+/* same result as to_sRGB_byte(), but with a table lookup instead of powf() */
+static inline BYTE linear_to_sRGB_byte(float f)
+{
+    UINT i = 0, step;
+
+    if (!(f >= 0.0f && f <= 1.0f)) return to_sRGB_byte(f);
+    for (step = 128; step; step >>= 1)
+        if (f >= sRGB_thresholds[i + step]) i += step;
+    return i;
+}
+
 #if 0 /* FIXME: enable once needed */
 static inline float from_sRGB_component(float f)
 {
@@ -1131,6 +1174,8 @@ static HRESULT copypixels_to_24bppBGR(struct FormatConverter *This, const WICRec
                 INT x, y;
                 BYTE *src = srcdata, *dst = pbBuffer;
 
+                InitOnceExecuteOnce(&sRGB_init_once, init_sRGB_thresholds, NULL, NULL);
+
                 for (y = 0; y < prc->Height; y++)
                 {
                     float *gray_float = (float *)src;
@@ -1138,7 +1183,7 @@ static HRESULT copypixels_to_24bppBGR(struct FormatConverter *This, const WICRec
 
                     for (x = 0; x < prc->Width; x++)
                     {
-                        BYTE gray = (BYTE)floorf(to_sRGB_component(gray_float[x]) * 255.0f + 0.51f);
+                        BYTE gray = linear_to_sRGB_byte(gray_float[x]);
                         *bgr++ = gray;
                         *bgr++ = gray;
                         *bgr++ = gray;
@@ -1351,13 +1396,15 @@ static HRESULT copypixels_to_8bppGray(struct FormatConverter *This, const WICRec
                 INT x, y;
                 BYTE *src = srcdata, *dst = pbBuffer;
 
+                InitOnceExecuteOnce(&sRGB_init_once, init_sRGB_thresholds, NULL, NULL);
+
                 for (y=0; y < prc->Height; y++)
                 {
                     float *srcpixel = (float*)src;
                     BYTE *dstpixel = dst;
 
                     for (x=0; x < prc->Width; x++)
-                        *dstpixel++ = (BYTE)floorf(to_sRGB_component(*srcpixel++) * 255.0f + 0.51f);
+                        *dstpixel++ = linear_to_sRGB_byte(*srcpixel++);
 
                     src += srcstride;
                     dst += cbStride;
@@ -1385,6 +1432,8 @@ static HRESULT copypixels_to_8bppGray(struct FormatConverter *This, const WICRec
         INT x, y;
         BYTE *src = srcdata, *dst = pbBuffer;
 
+        InitOnceExecuteOnce(&sRGB_init_once, init_sRGB_thresholds, NULL, NULL);
+
         for (y = 0; y < prc->Height; y++)
         {
             BYTE *bgr = src;
@@ -1393,8 +1442,7 @@ static HRESULT copypixels_to_8bppGray(struct FormatConverter *This, const WICRec
             {
                 float gray = (bgr[2] * 0.2126f + bgr[1] * 0.7152f + bgr[0] * 0.0722f) / 255.0f;
 
-                gray = to_sRGB_component(gray) * 255.0f;
-                dst[x] = (BYTE)floorf(gray + 0.51f);
+                dst[x] = linear_to_sRGB_byte(gray);
                 bgr += 3;
             }
             src += srcstride;
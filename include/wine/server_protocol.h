@@ -904,6 +904,19 @@ struct input_shared_memory
 };
 
 
+struct window_shared_memory
+{
+    unsigned int         seq;
+    user_handle_t        handle;
+    user_handle_t        parent;
+    user_handle_t        owner;
+    unsigned int         style;
+    unsigned int         ex_style;
+    lparam_t             id;
+};
+#define SHARED_WINDOWS_COUNT ((LAST_USER_HANDLE - FIRST_USER_HANDLE + 1) >> 1)
+
+
 #define SEQUENCE_MASK_BITS  4
 #define SEQUENCE_MASK ((1UL << SEQUENCE_MASK_BITS) - 1)
 
@@ -1430,6 +1443,24 @@ struct select_reply
 
 
 
+struct batch_requests_request
+{
+    struct request_header __header;
+    /* VARARG(requests,bytes); */
+    char __pad_12[4];
+};
+struct batch_requests_reply
+{
+    struct reply_header __header;
+    unsigned int count;
+    /* VARARG(replies,bytes); */
+    char __pad_12[4];
+};
+#define BATCH_ENTRY_ALIGN 8
+#define BATCH_MAX_REQUESTS 64
+
+
+
 struct create_event_request
 {
     struct request_header __header;
@@ -1871,7 +1902,7 @@ struct send_socket_reply
     obj_handle_t wait;
     unsigned int options;
     int          nonblocking;
-    char __pad_20[4];
+    int          icmp_over_dgram;
 };
 
 
@@ -5196,13 +5227,22 @@ struct add_completion_reply
 };
 
 
+struct completion_packet
+{
+    apc_param_t   ckey;
+    apc_param_t   cvalue;
+    apc_param_t   information;
+    unsigned int  status;
+    int           __pad;
+};
+
 
 struct remove_completion_request
 {
     struct request_header __header;
     obj_handle_t handle;
     int          waited;
-    char __pad_20[4];
+    unsigned int extra;
 };
 struct remove_completion_reply
 {
@@ -5211,6 +5251,7 @@ struct remove_completion_reply
     apc_param_t   cvalue;
     apc_param_t   information;
     unsigned int  status;
+    /* VARARG(extra,bytes); */
     char __pad_36[4];
 };
 
@@ -5822,6 +5863,7 @@ enum request
     REQ_open_process,
     REQ_open_thread,
     REQ_select,
+    REQ_batch_requests,
     REQ_create_event,
     REQ_event_op,
     REQ_query_event,
@@ -6120,6 +6162,7 @@ union generic_request
     struct open_process_request open_process_request;
     struct open_thread_request open_thread_request;
     struct select_request select_request;
+    struct batch_requests_request batch_requests_request;
     struct create_event_request create_event_request;
     struct event_op_request event_op_request;
     struct query_event_request query_event_request;
@@ -6416,6 +6459,7 @@ union generic_reply
     struct open_process_reply open_process_reply;
     struct open_thread_reply open_thread_reply;
     struct select_reply select_reply;
+    struct batch_requests_reply batch_requests_reply;
     struct create_event_reply create_event_reply;
     struct event_op_reply event_op_reply;
     struct query_event_reply query_event_reply;
@@ -6682,7 +6726,7 @@ union generic_reply
 
 /* ### protocol_version begin ### */
 
-#define SERVER_PROTOCOL_VERSION 759
+#define SERVER_PROTOCOL_VERSION 763
 
 /* ### protocol_version end ### */
 
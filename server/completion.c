@@ -410,6 +410,31 @@ DECL_HANDLER(remove_completion)
         reply->information = msg->information;
         free( msg );
 
+        /* return more packets at once if the client can take them */
+        if (req->extra && wait->depth)
+        {
+            struct completion_packet *packets;
+            unsigned int i, count = min( req->extra, wait->depth );
+
+            count = min( count, get_reply_max_size() / sizeof(*packets) );
+            if (count && (packets = set_reply_data_size( count * sizeof(*packets) )))
+            {
+                for (i = 0; i < count; i++)
+                {
+                    entry = list_head( &wait->queue );
+                    list_remove( entry );
+                    wait->depth--;
+                    msg = LIST_ENTRY( entry, struct comp_msg, queue_entry );
+                    packets[i].ckey        = msg->ckey;
+                    packets[i].cvalue      = msg->cvalue;
+                    packets[i].information = msg->information;
+                    packets[i].status      = msg->status;
+                    packets[i].__pad       = 0;
+                    free( msg );
+                }
+            }
+        }
+
         if (!completion_wait_signaled( &wait->obj, NULL ))
         {
             if (do_fsync())
@@ -164,6 +164,7 @@ extern const char *get_timeout_str( timeout_t timeout );
 
 extern struct object *create_desktop_map_directory( struct winstation *winstation );
 extern struct object *create_thread_map_directory( void );
+extern struct object *create_window_map_directory( void );
 
 /* file functions */
 
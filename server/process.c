@@ -199,6 +199,7 @@ struct type_descr job_type =
 
 static void job_dump( struct object *obj, int verbose );
 static int job_signaled( struct object *obj, struct wait_queue_entry *entry );
+static unsigned int job_get_fsync_idx( struct object *obj, enum fsync_type *type );
 static int job_close_handle( struct object *obj, struct process *process, obj_handle_t handle );
 static void job_destroy( struct object *obj );
 
@@ -216,6 +217,7 @@ struct job
     struct job *parent;
     struct list parent_job_entry;  /* list entry for parent job */
     struct list child_job_list;    /* list of child jobs */
+    unsigned int fsync_idx;        /* fsync shm index */
 };
 
 static const struct object_ops job_ops =
@@ -227,7 +229,7 @@ static const struct object_ops job_ops =
     remove_queue,                  /* remove_queue */
     job_signaled,                  /* signaled */
     NULL,                          /* get_esync_fd */
-    NULL,                          /* get_fsync_idx */
+    job_get_fsync_idx,             /* get_fsync_idx */
     no_satisfied,                  /* satisfied */
     no_signal,                     /* signal */
     no_get_fd,                     /* get_fd */
@@ -264,6 +266,10 @@ static struct job *create_job_object( struct object *root, const struct unicode_
             job->completion_port = NULL;
             job->completion_key = 0;
             job->parent = NULL;
+            job->fsync_idx = 0;
+
+            if (do_fsync())
+                job->fsync_idx = fsync_alloc_shm( 0, 0 );
         }
     }
     return job;
@@ -450,6 +456,7 @@ static void job_destroy( struct object *obj )
         list_remove( &job->parent_job_entry );
         release_object( job->parent );
     }
+    if (job->fsync_idx) fsync_free_shm_idx( job->fsync_idx );
 }
 
 static void job_dump( struct object *obj, int verbose )
@@ -466,6 +473,13 @@ static int job_signaled( struct object *obj, struct wait_queue_entry *entry )
     return job->signaled;
 }
 
+static unsigned int job_get_fsync_idx( struct object *obj, enum fsync_type *type )
+{
+    struct job *job = (struct job *)obj;
+    *type = FSYNC_MANUAL_SERVER;
+    return job->fsync_idx;
+}
+
 struct ptid_entry
 {
     void        *ptr;   /* entry ptr */
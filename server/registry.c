@@ -83,6 +83,9 @@ struct key
     int               last_subkey; /* last in use subkey */
     int               nb_subkeys;  /* count of allocated subkeys */
     struct key      **subkeys;     /* subkeys array */
+    struct key      **subkey_hash; /* hash table of subkeys, for keys with many subkeys */
+    unsigned int      hash_size;   /* size of the subkey hash table */
+    struct key       *hash_next;   /* next key in the hash bucket of the parent */
     struct key       *wow6432node; /* Wow6432Node subkey */
     int               last_value;  /* last in use value */
     int               nb_values;   /* count of allocated values in array */
@@ -115,6 +118,7 @@ struct key_value
 
 #define MIN_SUBKEYS  8   /* min. number of allocated subkeys per key */
 #define MIN_VALUES   8   /* min. number of allocated values per key */
+#define MIN_HASHED_SUBKEYS 64  /* min. number of subkeys to use a hash table */
 
 #define MAX_NAME_LEN  256    /* max. length of a key name */
 #define MAX_VALUE_LEN 16383  /* max. length of a value name */
@@ -158,6 +162,12 @@ struct file_load_info
     int         line;     /* current input line */
     WCHAR      *tmp;      /* temp buffer to use while parsing input */
     size_t      tmplen;   /* length of temp buffer */
+    WCHAR      *path;     /* path of the last loaded key, relative to the base key */
+    data_size_t *path_ends; /* offset of the end of each element of the last path */
+    struct key **path_keys; /* keys of each element of the last path */
+    unsigned int depth;   /* number of elements in the last path */
+    unsigned int path_size; /* allocated size of the path arrays */
+    data_size_t path_len; /* allocated size of the path buffer */
 };
 
 
@@ -287,12 +297,76 @@ static void dump_value( const struct key_value *value, FILE *f )
     fputc( '\n', f );
 }
 
+/* add a subkey to the hash table of its parent */
+static void hash_subkey( struct key *parent, struct key *key, const WCHAR *name, data_size_t len )
+{
+    unsigned int hash = hash_strW( name, len, parent->hash_size );
+
+    key->hash_next = parent->subkey_hash[hash];
+    parent->subkey_hash[hash] = key;
+}
+
+/* remove a subkey from the hash table of its parent */
+static void unhash_subkey( struct key *parent, struct key *key, const WCHAR *name, data_size_t len )
+{
+    unsigned int hash = hash_strW( name, len, parent->hash_size );
+    struct key **ptr;
+
+    for (ptr = &parent->subkey_hash[hash]; *ptr; ptr = &(*ptr)->hash_next)
+    {
+        if (*ptr != key) continue;
+        *ptr = key->hash_next;
+        break;
+    }
+    key->hash_next = NULL;
+}
+
+/* (re)build the subkey hash table once the key has enough subkeys */
+/* the subkey being linked is skipped, its object name isn't set yet */
+static void rehash_subkeys( struct key *key, struct key *skip )
+{
+    unsigned int i, count = key->last_subkey + 1, size = count * 2;
+    struct key **new_hash;
+
+    if (!(new_hash = calloc( size, sizeof(*new_hash) ))) return;  /* keep using the old table */
+    free( key->subkey_hash );
+    key->subkey_hash = new_hash;
+    key->hash_size = size;
+    for (i = 0; i < count; i++)
+    {
+        struct key *subkey = key->subkeys[i];
+        if (subkey != skip) hash_subkey( key, subkey, subkey->obj.name->name, subkey->obj.name->len );
+    }
+}
+
+/* add a newly linked subkey to the hash table, creating or growing it as needed */
+static void add_subkey_hash( struct key *parent, struct key *key, const struct object_name *name )
+{
+    unsigned int count = parent->last_subkey + 1;
+
+    if (count > parent->hash_size && count >= MIN_HASHED_SUBKEYS) rehash_subkeys( parent, key );
+    if (parent->subkey_hash) hash_subkey( parent, key, name->name, name->len );
+}
+
 /* find the named child of a given key and return its index */
+/* the index can be NULL when not needed, so that the hash table can be used instead */
 static struct key *find_subkey( const struct key *key, const struct unicode_str *name, int *index )
 {
     int i, min, max, res;
     data_size_t len;
 
+    if (!index && key->subkey_hash)
+    {
+        struct key *subkey = key->subkey_hash[hash_strW( name->str, name->len, key->hash_size )];
+
+        for ( ; subkey; subkey = subkey->hash_next)
+        {
+            if (subkey->obj.name->len != name->len) continue;
+            if (!memicmp_strW( subkey->obj.name->name, name->str, name->len )) return subkey;
+        }
+        return NULL;
+    }
+
     min = 0;
     max = key->last_subkey;
     while (min <= max)
@@ -303,13 +377,13 @@ static struct key *find_subkey( const struct key *key, const struct unicode_str
         if (!res) res = key->subkeys[i]->obj.name->len - name->len;
         if (!res)
         {
-            *index = i;
+            if (index) *index = i;
             return key->subkeys[i];
         }
         if (res > 0) max = i - 1;
         else min = i + 1;
     }
-    *index = min;  /* this is where we should insert it */
+    if (index) *index = min;  /* this is where we should insert it */
     return NULL;
 }
 
@@ -545,13 +619,13 @@ static struct object *key_lookup_name( struct object *obj, struct unicode_str *n
     for (next = tmp.len; next < name->len; next += sizeof(WCHAR))
         if (name->str[next / sizeof(WCHAR)] != '\\') break;
 
-    if (!(found = find_subkey( key, &tmp, &index )))
+    if (!(found = find_subkey( key, &tmp, NULL )))
     {
         if ((key->flags & KEY_WOWSHARE) && (attr & OBJ_KEY_WOW64))
         {
             /* try in the 64-bit parent */
             key = get_parent( key );
-            if (!(found = find_subkey( key, &tmp, &index ))) return grab_object( key );
+            if (!(found = find_subkey( key, &tmp, NULL ))) return grab_object( key );
         }
     }
 
@@ -584,7 +658,11 @@ static int key_link_name( struct object *obj, struct object_name *name, struct o
     struct key *key = (struct key *)obj;
     struct key *parent_key = (struct key *)parent;
     struct unicode_str tmp;
-    int i, index;
+    int index;
+
+    key->subkey_hash = NULL;
+    key->hash_size   = 0;
+    key->hash_next   = NULL;
 
     if (parent->ops != &key_ops)
     {
@@ -603,9 +681,10 @@ static int key_link_name( struct object *obj, struct object_name *name, struct o
     tmp.len = name->len;
     find_subkey( parent_key, &tmp, &index );
 
-    for (i = ++parent_key->last_subkey; i > index; i--)
-        parent_key->subkeys[i] = parent_key->subkeys[i - 1];
+    memmove( parent_key->subkeys + index + 1, parent_key->subkeys + index,
+             (++parent_key->last_subkey - index) * sizeof(*parent_key->subkeys) );
     parent_key->subkeys[index] = (struct key *)grab_object( key );
+    add_subkey_hash( parent_key, key, name );
     if (is_wow6432node( name->name, name->len ) &&
         !is_wow6432node( parent_key->obj.name->name, parent_key->obj.name->len ))
         parent_key->wow6432node = key;
@@ -617,7 +696,7 @@ static void key_unlink_name( struct object *obj, struct object_name *name )
 {
     struct key *key = (struct key *)obj;
     struct key *parent = (struct key *)name->parent;
-    int i, nb_subkeys;
+    int index, nb_subkeys;
 
     if (!parent) return;
 
@@ -627,9 +706,12 @@ static void key_unlink_name( struct object *obj, struct object_name *name )
         return;
     }
 
-    for (i = 0; i <= parent->last_subkey; i++) if (parent->subkeys[i] == key) break;
-    assert( i <= parent->last_subkey );
-    for ( ; i < parent->last_subkey; i++) parent->subkeys[i] = parent->subkeys[i + 1];
+    /* the key's object name is already cleared, so it can't be found with a binary search */
+    for (index = 0; index <= parent->last_subkey; index++) if (parent->subkeys[index] == key) break;
+    assert( index <= parent->last_subkey );
+    if (parent->subkey_hash) unhash_subkey( parent, key, name->name, name->len );
+    memmove( parent->subkeys + index, parent->subkeys + index + 1,
+             (parent->last_subkey - index) * sizeof(*parent->subkeys) );
     parent->last_subkey--;
     name->parent = NULL;
     if (parent->wow6432node == key) parent->wow6432node = NULL;
@@ -677,6 +759,7 @@ static void key_destroy( struct object *obj )
         release_object( key->subkeys[i] );
     }
     free( key->subkeys );
+    free( key->subkey_hash );
     /* unconditionally notify everything waiting on this key */
     while ((ptr = list_head( &key->notify_list )))
     {
@@ -793,7 +876,6 @@ static struct key *get_wow6432node( struct key *key )
 {
     struct key *parent, *ret;
     struct unicode_str name;
-    int index;
 
     if (!key)
         return NULL;
@@ -810,7 +892,7 @@ static struct key *get_wow6432node( struct key *key )
 
     name.str = key->obj.name->name;
     name.len = key->obj.name->len;
-    return find_subkey( ret, &name, &index );
+    return find_subkey( ret, &name, NULL );
 }
 
 /* open a subkey */
@@ -1007,8 +1089,9 @@ static void rename_key( struct key *key, const struct unicode_str *new_name )
 {
     struct object_name *new_name_ptr;
     struct key *subkey, *parent = get_parent( key );
+    struct unicode_str old_name;
     data_size_t len;
-    int i, index, cur_index;
+    int index, cur_index;
 
     /* changing to a path is not allowed */
     len = get_path_element( new_name->str, new_name->len );
@@ -1039,22 +1122,28 @@ static void rename_key( struct key *key, const struct unicode_str *new_name )
     new_name_ptr->parent = &parent->obj;
     memcpy( new_name_ptr->name, new_name->str, new_name->len );
 
-    for (cur_index = 0; cur_index <= parent->last_subkey; cur_index++)
-        if (parent->subkeys[cur_index] == key) break;
+    old_name.str = key->obj.name->name;
+    old_name.len = key->obj.name->len;
+    find_subkey( parent, &old_name, &cur_index );
+    assert( cur_index <= parent->last_subkey && parent->subkeys[cur_index] == key );
 
     if (cur_index < index && (index - cur_index) > 1)
     {
         --index;
-        for (i = cur_index; i < index; ++i) parent->subkeys[i] = parent->subkeys[i+1];
+        memmove( parent->subkeys + cur_index, parent->subkeys + cur_index + 1,
+                 (index - cur_index) * sizeof(*parent->subkeys) );
     }
     else if (cur_index > index)
     {
-        for (i = cur_index; i > index; --i) parent->subkeys[i] = parent->subkeys[i-1];
+        memmove( parent->subkeys + index + 1, parent->subkeys + index,
+                 (cur_index - index) * sizeof(*parent->subkeys) );
     }
     parent->subkeys[index] = key;
 
+    if (parent->subkey_hash) unhash_subkey( parent, key, key->obj.name->name, key->obj.name->len );
     free( key->obj.name );
     key->obj.name = new_name_ptr;
+    if (parent->subkey_hash) hash_subkey( parent, key, new_name_ptr->name, new_name_ptr->len );
 
     if (debug_level > 1) dump_operation( key, NULL, "Rename" );
     touch_key( key, REG_NOTIFY_CHANGE_NAME );
@@ -1152,7 +1241,6 @@ static struct key_value *insert_value( struct key *key, const struct unicode_str
 {
     struct key_value *value;
     WCHAR *new_name = NULL;
-    int i;
 
     if (name->len > MAX_VALUE_LEN * sizeof(WCHAR))
     {
@@ -1164,7 +1252,8 @@ static struct key_value *insert_value( struct key *key, const struct unicode_str
         if (!grow_values( key )) return NULL;
     }
     if (name->len && !(new_name = memdup( name->str, name->len ))) return NULL;
-    for (i = ++key->last_value; i > index; i--) key->values[i] = key->values[i - 1];
+    memmove( key->values + index + 1, key->values + index,
+             (++key->last_value - index) * sizeof(*key->values) );
     value = &key->values[index];
     value->name    = new_name;
     value->namelen = name->len;
@@ -1314,7 +1403,7 @@ static void enum_value( struct key *key, int i, int info_class, struct enum_key_
 static void delete_value( struct key *key, const struct unicode_str *name )
 {
     struct key_value *value;
-    int i, index, nb_values;
+    int index, nb_values;
 
     if (key->flags & KEY_PREDEF)
     {
@@ -1330,7 +1419,8 @@ static void delete_value( struct key *key, const struct unicode_str *name )
     if (debug_level > 1) dump_operation( key, value, "Delete" );
     free( value->name );
     free( value->data );
-    for (i = index; i < key->last_value; i++) key->values[i] = key->values[i + 1];
+    memmove( key->values + index, key->values + index + 1,
+             (key->last_value - index) * sizeof(*key->values) );
     key->last_value--;
     touch_key( key, REG_NOTIFY_CHANGE_LAST_SET );
 
@@ -1451,6 +1541,100 @@ static int get_data_type( const char *buffer, int *type, int *parse_type )
     return 0;
 }
 
+/* forget the keys of the last loaded path */
+static void clear_load_path( struct file_load_info *info, unsigned int depth )
+{
+    while (info->depth > depth) release_object( info->path_keys[--info->depth] );
+}
+
+/* create a key while loading a file; keys are saved in tree order, so the elements
+ * shared with the previously loaded path are reused instead of being looked up again */
+static struct key *create_loaded_key( struct key *base, const struct unicode_str *name,
+                                      struct file_load_info *info )
+{
+    struct key *key, *parent = base;
+    struct unicode_str tmp;
+    const WCHAR *str = name->str;
+    data_size_t len = name->len, pos = 0;
+    unsigned int depth = 0;
+
+    /* find the elements in common with the last path */
+    while (depth < info->depth)
+    {
+        data_size_t end = info->path_ends[depth];
+
+        if (end > name->len || memcmp( name->str + pos / sizeof(WCHAR), info->path + pos / sizeof(WCHAR),
+                                       end - pos )) break;
+        if (end < name->len && name->str[end / sizeof(WCHAR)] != '\\') break;
+        parent = info->path_keys[depth++];
+        pos = end;
+        if (end == name->len) break;
+        pos += sizeof(WCHAR);
+    }
+    clear_load_path( info, depth );
+
+    if (name->len > info->path_len)
+    {
+        WCHAR *new_path = realloc( info->path, name->len );
+        if (!new_path)
+        {
+            set_error( STATUS_NO_MEMORY );
+            clear_load_path( info, 0 );
+            return NULL;
+        }
+        info->path = new_path;
+        info->path_len = name->len;
+    }
+    memcpy( info->path, name->str, name->len );
+
+    str += pos / sizeof(WCHAR);
+    len -= pos;
+    while (len)
+    {
+        if (info->depth == info->path_size)
+        {
+            unsigned int new_size = max( 16, info->path_size * 2 );
+            data_size_t *new_ends;
+            struct key **new_keys;
+
+            if ((new_ends = realloc( info->path_ends, new_size * sizeof(*new_ends) )))
+                info->path_ends = new_ends;
+            if ((new_keys = realloc( info->path_keys, new_size * sizeof(*new_keys) )))
+                info->path_keys = new_keys;
+            if (!new_ends || !new_keys)
+            {
+                set_error( STATUS_NO_MEMORY );
+                clear_load_path( info, 0 );
+                return NULL;
+            }
+            info->path_size = new_size;
+        }
+
+        tmp.str = str;
+        tmp.len = get_path_element( str, len );
+        if (!(key = create_key_object( &parent->obj, &tmp, OBJ_OPENIF, 0, 0, NULL )))
+        {
+            clear_load_path( info, 0 );
+            return NULL;
+        }
+        pos += tmp.len;
+        info->path_keys[info->depth] = key;
+        info->path_ends[info->depth++] = pos;
+        parent = key;
+
+        /* skip trailing \\ and move to the next element */
+        if (tmp.len < len)
+        {
+            tmp.len += sizeof(WCHAR);
+            pos += sizeof(WCHAR);
+            str += tmp.len / sizeof(WCHAR);
+            len -= tmp.len;
+        }
+        else break;
+    }
+    return (struct key *)grab_object( parent );
+}
+
 /* load and create a key from the input file */
 static struct key *load_key( struct key *base, const char *buffer, int prefix_len,
                              struct file_load_info *info, timeout_t *modif )
@@ -1489,7 +1673,7 @@ static struct key *load_key( struct key *base, const char *buffer, int prefix_le
     }
     name.str = p;
     name.len = len - (p - info->tmp + 1) * sizeof(WCHAR);
-    return create_key_recursive( base, &name, 0 );
+    return create_loaded_key( base, &name, info );
 }
 
 /* update the modification time of a key (and its parents) after it has been loaded from a file */
@@ -1560,7 +1744,12 @@ static int load_key_option( struct key *key, const char *buffer, struct file_loa
         if (!(key->class = memdup( info->tmp, len ))) len = 0;
         key->classlen = len;
     }
-    if (!strncmp( buffer, "#link", 5 )) key->flags |= KEY_SYMLINK;
+    if (!strncmp( buffer, "#link", 5 ))
+    {
+        key->flags |= KEY_SYMLINK;
+        /* paths through the key must now follow the link */
+        clear_load_path( info, 0 );
+    }
     /* ignore unknown options */
     return 1;
 }
@@ -1731,6 +1920,12 @@ static void load_keys( struct key *key, const char *filename, FILE *f, int prefi
     info.len    = 4;
     info.tmplen = 4;
     info.line   = 0;
+    info.path   = NULL;
+    info.path_ends = NULL;
+    info.path_keys = NULL;
+    info.depth  = 0;
+    info.path_size = 0;
+    info.path_len = 0;
     if (!(info.buffer = mem_alloc( info.len ))) return;
     if (!(info.tmp = mem_alloc( info.tmplen )))
     {
@@ -1785,6 +1980,10 @@ static void load_keys( struct key *key, const char *filename, FILE *f, int prefi
         update_key_time( subkey, modif );
         release_object( subkey );
     }
+    clear_load_path( &info, 0 );
+    free( info.path );
+    free( info.path_ends );
+    free( info.path_keys );
     free( info.buffer );
     free( info.tmp );
 }
@@ -326,25 +326,164 @@ static void call_req_handler( struct thread *thread )
     current = NULL;
 }
 
+/* size of a batch entry, including padding */
+static inline data_size_t batch_entry_size( data_size_t size )
+{
+    return (size + BATCH_ENTRY_ALIGN - 1) & ~(BATCH_ENTRY_ALIGN - 1);
+}
+
+/* execute a batch of independent requests on behalf of the current thread */
+DECL_HANDLER(batch_requests)
+{
+    struct thread *thread = current;
+    union generic_request batch = thread->req;
+    void *batch_data = thread->req_data;
+    const char *ptr = get_req_data(), *end = ptr + get_req_data_size();
+    data_size_t size = 0, pos = 0, entry;
+    unsigned int count = 0;
+    char *replies;
+
+    /* validate the whole batch first and compute the maximum reply size */
+    while (ptr < end)
+    {
+        const union generic_request *sub = (const union generic_request *)ptr;
+
+        if (end - ptr < sizeof(*sub) ||
+            end - ptr - sizeof(*sub) < sub->request_header.request_size ||
+            sub->request_header.req >= REQ_NB_REQUESTS ||
+            sub->request_header.req == REQ_batch_requests ||
+            sub->request_header.req == REQ_select ||
+            ++count > BATCH_MAX_REQUESTS)
+        {
+            set_error( STATUS_INVALID_PARAMETER );
+            return;
+        }
+        /* size never exceeds the maximum reply size, so the subtraction can't wrap */
+        entry = batch_entry_size( sizeof(union generic_reply) + sub->request_header.reply_size );
+        if (sub->request_header.reply_size > get_reply_max_size() ||
+            entry < sub->request_header.reply_size ||
+            entry > get_reply_max_size() - size)
+        {
+            set_error( STATUS_BUFFER_OVERFLOW );
+            return;
+        }
+        size += entry;
+        ptr += min( end - ptr, batch_entry_size( sizeof(*sub) + sub->request_header.request_size ));
+    }
+    if (!(replies = mem_alloc( size ))) return;
+
+    /* the thread may get killed by one of the requests, in which case its request
+     * data is freed, so each request gets its own copy of the data */
+    thread->req_data = NULL;
+    ptr = batch_data;
+    for (count = 0; ptr < end; count++)
+    {
+        const union generic_request *sub = (const union generic_request *)ptr;
+        union generic_reply *sub_reply = (union generic_reply *)(replies + pos);
+        enum request type = sub->request_header.req;
+
+        ptr += min( end - ptr, batch_entry_size( sizeof(*sub) + sub->request_header.request_size ));
+        thread->req = *sub;
+        thread->reply_size = 0;
+        thread->reply_data = NULL;
+        if (sub->request_header.request_size &&
+            !(thread->req_data = memdup( sub + 1, sub->request_header.request_size ))) break;
+
+        clear_error();
+        memset( sub_reply, 0, sizeof(*sub_reply) );
+        if (debug_level) trace_request();
+        req_handlers[type]( &thread->req, sub_reply );
+        if (!current) break;  /* the thread has been killed */
+
+        sub_reply->reply_header.error = thread->error;
+        sub_reply->reply_header.reply_size = thread->reply_size;
+        if (debug_level) trace_reply( type, sub_reply );
+        entry = batch_entry_size( sizeof(*sub_reply) + thread->reply_size );
+        assert( pos + entry <= size );
+        if (thread->reply_size) memcpy( sub_reply + 1, thread->reply_data, thread->reply_size );
+        pos += entry;
+        free( thread->reply_data );
+        thread->reply_data = NULL;
+        free( thread->req_data );
+        thread->req_data = NULL;
+    }
+
+    if (!current)
+    {
+        free( batch_data );
+        free( replies );
+        return;
+    }
+    thread->req = batch;
+    thread->req_data = batch_data;
+    thread->reply_size = 0;
+    clear_error();
+    set_reply_data_ptr( replies, pos );
+    reply->count = count;
+}
+
+/* size of the request data buffer that is kept around between requests */
+#define REQ_DATA_KEEP_SIZE 4096
+
+/* release the request data buffer once a request has been handled */
+static void release_req_data( struct thread *thread )
+{
+    if (thread->req_data_size <= REQ_DATA_KEEP_SIZE) return;
+    free( thread->req_data );
+    thread->req_data = NULL;
+    thread->req_data_size = 0;
+}
+
 /* read a request from a thread */
 void read_request( struct thread *thread )
 {
+    data_size_t size;
     int ret;
 
     if (!thread->req_toread)  /* no pending request */
     {
-        if ((ret = read( get_unix_fd( thread->request_fd ), &thread->req,
-                         sizeof(thread->req) )) != sizeof(thread->req)) goto error;
-        if (!(thread->req_toread = thread->req.request_header.request_size))
+        struct iovec vec[2];
+
+        /* the client waits for the reply before sending anything else, so the pipe only
+         * contains the current request; read its data along with the header if possible */
+        vec[0].iov_base = &thread->req;
+        vec[0].iov_len  = sizeof(thread->req);
+        vec[1].iov_base = thread->req_data;
+        vec[1].iov_len  = thread->req_data_size;
+
+        if ((ret = readv( get_unix_fd( thread->request_fd ), vec, thread->req_data ? 2 : 1 ))
+            < (int)sizeof(thread->req)) goto error;
+        ret -= sizeof(thread->req);
+
+        if (ret > (size = thread->req.request_header.request_size))
+        {
+            fatal_protocol_error( thread, "extra data %u in request %d\n",
+                                  ret - size, thread->req.request_header.req );
+            return;
+        }
+        if (!size)
         {
             /* no data, handle request at once */
             call_req_handler( thread );
             return;
         }
-        if (!(thread->req_data = malloc( thread->req_toread )))
+        if (size > thread->req_data_size)
         {
-            fatal_protocol_error( thread, "no memory for %u bytes request %d\n",
-                                  thread->req_toread, thread->req.request_header.req );
+            void *data;
+
+            if (!(data = realloc( thread->req_data, size )))
+            {
+                fatal_protocol_error( thread, "no memory for %u bytes request %d\n",
+                                      size, thread->req.request_header.req );
+                return;
+            }
+            thread->req_data = data;
+            thread->req_data_size = size;
+        }
+        if (!(thread->req_toread = size - ret))
+        {
+            call_req_handler( thread );
+            release_req_data( thread );
             return;
         }
     }
@@ -360,8 +499,7 @@ void read_request( struct thread *thread )
         if (!(thread->req_toread -= ret))
         {
             call_req_handler( thread );
-            free( thread->req_data );
-            thread->req_data = NULL;
+            release_req_data( thread );
             return;
         }
     }
@@ -148,6 +148,7 @@ DECL_HANDLER(make_temporary);
 DECL_HANDLER(open_process);
 DECL_HANDLER(open_thread);
 DECL_HANDLER(select);
+DECL_HANDLER(batch_requests);
 DECL_HANDLER(create_event);
 DECL_HANDLER(event_op);
 DECL_HANDLER(query_event);
@@ -445,6 +446,7 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_open_process,
     (req_handler)req_open_thread,
     (req_handler)req_select,
+    (req_handler)req_batch_requests,
     (req_handler)req_create_event,
     (req_handler)req_event_op,
     (req_handler)req_query_event,
@@ -936,6 +938,9 @@ C_ASSERT( FIELD_OFFSET(struct select_reply, call) == 8 );
 C_ASSERT( FIELD_OFFSET(struct select_reply, apc_handle) == 56 );
 C_ASSERT( FIELD_OFFSET(struct select_reply, signaled) == 60 );
 C_ASSERT( sizeof(struct select_reply) == 64 );
+C_ASSERT( sizeof(struct batch_requests_request) == 16 );
+C_ASSERT( FIELD_OFFSET(struct batch_requests_reply, count) == 8 );
+C_ASSERT( sizeof(struct batch_requests_reply) == 16 );
 C_ASSERT( FIELD_OFFSET(struct create_event_request, access) == 12 );
 C_ASSERT( FIELD_OFFSET(struct create_event_request, manual_reset) == 16 );
 C_ASSERT( FIELD_OFFSET(struct create_event_request, initial_state) == 20 );
@@ -1089,6 +1094,7 @@ C_ASSERT( sizeof(struct send_socket_request) == 64 );
 C_ASSERT( FIELD_OFFSET(struct send_socket_reply, wait) == 8 );
 C_ASSERT( FIELD_OFFSET(struct send_socket_reply, options) == 12 );
 C_ASSERT( FIELD_OFFSET(struct send_socket_reply, nonblocking) == 16 );
+C_ASSERT( FIELD_OFFSET(struct send_socket_reply, icmp_over_dgram) == 20 );
 C_ASSERT( sizeof(struct send_socket_reply) == 24 );
 C_ASSERT( FIELD_OFFSET(struct socket_send_icmp_id_request, handle) == 12 );
 C_ASSERT( FIELD_OFFSET(struct socket_send_icmp_id_request, icmp_id) == 16 );
@@ -2191,6 +2197,7 @@ C_ASSERT( FIELD_OFFSET(struct add_completion_request, status) == 40 );
 C_ASSERT( sizeof(struct add_completion_request) == 48 );
 C_ASSERT( FIELD_OFFSET(struct remove_completion_request, handle) == 12 );
 C_ASSERT( FIELD_OFFSET(struct remove_completion_request, waited) == 16 );
+C_ASSERT( FIELD_OFFSET(struct remove_completion_request, extra) == 20 );
 C_ASSERT( sizeof(struct remove_completion_request) == 24 );
 C_ASSERT( FIELD_OFFSET(struct remove_completion_reply, ckey) == 8 );
 C_ASSERT( FIELD_OFFSET(struct remove_completion_reply, cvalue) == 16 );
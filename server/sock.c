@@ -262,6 +262,7 @@ struct sock
     unsigned int        reset : 1;   /* did we get a TCP reset? */
     unsigned int        reuseaddr : 1; /* winsock SO_REUSEADDR option value */
     unsigned int        exclusiveaddruse : 1; /* winsock SO_EXCLUSIVEADDRUSE option value */
+    unsigned int        icmp_over_dgram : 1; /* is this a raw ICMP socket emulated with SOCK_DGRAM? */
 };
 
 static int is_tcp_socket( struct sock *sock )
@@ -1730,6 +1731,7 @@ static struct sock *create_socket(void)
     sock->reset = 0;
     sock->reuseaddr = 0;
     sock->exclusiveaddruse = 0;
+    sock->icmp_over_dgram = 0;
     sock->default_rcvbuf = 0;
     sock->rcvbuf = 0;
     sock->sndbuf = 0;
@@ -1863,6 +1865,7 @@ static int init_socket( struct sock *sock, int family, int type, int protocol )
         {
             const int val = 1;
 
+            sock->icmp_over_dgram = 1;
             setsockopt( sockfd, IPPROTO_IP, IP_RECVTTL, (const char *)&val, sizeof(val) );
             setsockopt( sockfd, IPPROTO_IP, IP_RECVTOS, (const char *)&val, sizeof(val) );
             setsockopt( sockfd, IPPROTO_IP, IP_PKTINFO, (const char *)&val, sizeof(val) );
@@ -3947,6 +3950,7 @@ DECL_HANDLER(send_socket)
         reply->wait = async_handoff( async, NULL, 0 );
         reply->options = get_fd_options( fd );
         reply->nonblocking = sock->nonblocking;
+        reply->icmp_over_dgram = sock->icmp_over_dgram;
         release_object( async );
     }
     release_object( sock );
@@ -67,6 +67,7 @@ struct thread
     unsigned int           error;         /* current error code */
     union generic_request  req;           /* current request */
     void                  *req_data;      /* variable-size data for request */
+    data_size_t            req_data_size; /* allocated size of the request data buffer */
     unsigned int           req_toread;    /* amount of data still to read in request */
     void                  *reply_data;    /* variable-size data for reply */
     unsigned int           reply_size;    /* size of reply data */
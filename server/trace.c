@@ -1754,6 +1754,17 @@ static void dump_select_reply( const struct select_reply *req )
     dump_varargs_contexts( ", contexts=", cur_size );
 }
 
+static void dump_batch_requests_request( const struct batch_requests_request *req )
+{
+    dump_varargs_bytes( " requests=", cur_size );
+}
+
+static void dump_batch_requests_reply( const struct batch_requests_reply *req )
+{
+    fprintf( stderr, " count=%08x", req->count );
+    dump_varargs_bytes( ", replies=", cur_size );
+}
+
 static void dump_create_event_request( const struct create_event_request *req )
 {
     fprintf( stderr, " access=%08x", req->access );
@@ -2080,6 +2091,7 @@ static void dump_send_socket_reply( const struct send_socket_reply *req )
     fprintf( stderr, " wait=%04x", req->wait );
     fprintf( stderr, ", options=%08x", req->options );
     fprintf( stderr, ", nonblocking=%d", req->nonblocking );
+    fprintf( stderr, ", icmp_over_dgram=%d", req->icmp_over_dgram );
 }
 
 static void dump_socket_send_icmp_id_request( const struct socket_send_icmp_id_request *req )
@@ -4320,6 +4332,7 @@ static void dump_remove_completion_request( const struct remove_completion_reque
 {
     fprintf( stderr, " handle=%04x", req->handle );
     fprintf( stderr, ", waited=%d", req->waited );
+    fprintf( stderr, ", extra=%08x", req->extra );
 }
 
 static void dump_remove_completion_reply( const struct remove_completion_reply *req )
@@ -4328,6 +4341,7 @@ static void dump_remove_completion_reply( const struct remove_completion_reply *
     dump_uint64( ", cvalue=", &req->cvalue );
     dump_uint64( ", information=", &req->information );
     fprintf( stderr, ", status=%08x", req->status );
+    dump_varargs_bytes( ", extra=", cur_size );
 }
 
 static void dump_query_completion_request( const struct query_completion_request *req )
@@ -4703,6 +4717,7 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_open_process_request,
     (dump_func)dump_open_thread_request,
     (dump_func)dump_select_request,
+    (dump_func)dump_batch_requests_request,
     (dump_func)dump_create_event_request,
     (dump_func)dump_event_op_request,
     (dump_func)dump_query_event_request,
@@ -4997,6 +5012,7 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_open_process_reply,
     (dump_func)dump_open_thread_reply,
     (dump_func)dump_select_reply,
+    (dump_func)dump_batch_requests_reply,
     (dump_func)dump_create_event_reply,
     (dump_func)dump_event_op_reply,
     (dump_func)dump_query_event_reply,
@@ -5291,6 +5307,7 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "open_process",
     "open_thread",
     "select",
+    "batch_requests",
     "create_event",
     "event_op",
     "query_event",
@@ -30,6 +30,7 @@
 #include "ntuser.h"
 
 #include "object.h"
+#include "file.h"
 #include "request.h"
 #include "thread.h"
 #include "process.h"
@@ -247,6 +248,58 @@ static inline void update_pixel_format_flags( struct window *win )
         win->paint_flags |= PAINT_PIXEL_FORMAT_CHILD;
 }
 
+static struct object *windows_shared_mapping;                  /* mapping of the shared window state */
+static volatile struct window_shared_memory *windows_shared;   /* shared window state, indexed by handle */
+
+/* get the shared state entry of a window, creating the shared mapping if needed */
+static volatile struct window_shared_memory *get_window_shared( user_handle_t handle )
+{
+    if (!windows_shared_mapping)
+    {
+        static const WCHAR windowsW[] = {'w','i','n','d','o','w','s'};
+        static const struct unicode_str name = {windowsW, sizeof(windowsW)};
+        struct object *dir = create_window_map_directory();
+
+        if (!dir) return NULL;
+        windows_shared_mapping = create_shared_mapping( dir, &name, SHARED_WINDOWS_COUNT * sizeof(*windows_shared),
+                                                        NULL, (void **)&windows_shared );
+        release_object( dir );
+        if (!windows_shared_mapping) return NULL;
+    }
+    return &windows_shared[((handle & 0xffff) - FIRST_USER_HANDLE) >> 1];
+}
+
+/* update the shared state of a window, for the client to read without a server call */
+static void update_window_shared( struct window *win )
+{
+    volatile struct window_shared_memory *shared;
+
+    if (!win->handle || !(shared = get_window_shared( win->handle ))) return;
+    SHARED_WRITE_BEGIN( &shared->seq );
+    shared->handle   = win->handle;
+    shared->parent   = win->parent ? win->parent->handle : 0;
+    shared->owner    = win->owner;
+    shared->style    = win->style;
+    shared->ex_style = win->ex_style;
+    shared->id       = win->id;
+    SHARED_WRITE_END( &shared->seq );
+}
+
+/* free the user handle of a window, and clear its shared state */
+static void free_window_user_handle( struct window *win )
+{
+    volatile struct window_shared_memory *shared;
+
+    if ((shared = get_window_shared( win->handle )))
+    {
+        SHARED_WRITE_BEGIN( &shared->seq );
+        shared->handle = 0;
+        SHARED_WRITE_END( &shared->seq );
+    }
+    free_user_handle( win->handle );
+    win->handle = 0;
+}
+
 /* get the per-monitor DPI for a window */
 static unsigned int get_monitor_dpi( struct window *win )
 {
@@ -311,6 +364,7 @@ static int link_window( struct window *win, struct window *previous )
     }
 
     win->is_linked = 1;
+    update_window_shared( win );
     return old_prev != win->entry.prev;
 }
 
@@ -597,6 +651,7 @@ static struct window *create_window( struct window *parent, struct window *owner
         win->nb_extra_bytes = extra_bytes;
     }
     if (!(win->handle = alloc_user_handle( win, USER_WINDOW ))) goto failed;
+    update_window_shared( win );
 
     /* if parent belongs to a different thread and the window isn't */
     /* top-level, attach the two threads */
@@ -633,11 +688,7 @@ static struct window *create_window( struct window *parent, struct window *owner
 failed:
     if (win)
     {
-        if (win->handle)
-        {
-            free_user_handle( win->handle );
-            win->handle = 0;
-        }
+        if (win->handle) free_window_user_handle( win );
         release_object( win );
     }
     release_object( desktop );
@@ -1813,6 +1864,7 @@ static void set_window_pos( struct window *win, struct window *previous,
     if (!(swp_flags & SWP_NOZORDER) && win->parent) zorder_changed |= link_window( win, previous );
     if (swp_flags & SWP_SHOWWINDOW) win->style |= WS_VISIBLE;
     else if (swp_flags & SWP_HIDEWINDOW) win->style &= ~WS_VISIBLE;
+    update_window_shared( win );
 
     /* keep children at the same position relative to top right corner when the parent is mirrored */
     if (win->ex_style & WS_EX_LAYOUTRTL)
@@ -2045,8 +2097,7 @@ void free_window_handle( struct window *win )
     detach_window_thread( win );
 
     if (win->parent) set_parent_window( win, NULL );
-    free_user_handle( win->handle );
-    win->handle = 0;
+    free_window_user_handle( win );
     release_object( win );
 }
 
@@ -2100,6 +2151,7 @@ DECL_HANDLER(create_window)
     }
     win->style = req->style;
     win->ex_style = req->ex_style;
+    update_window_shared( win );
 
     reply->handle    = win->handle;
     reply->parent    = win->parent ? win->parent->handle : 0;
@@ -2167,6 +2219,7 @@ DECL_HANDLER(get_desktop_window)
         {
             detach_window_thread( desktop->top_window );
             desktop->top_window->style  = WS_POPUP | WS_VISIBLE | WS_CLIPSIBLINGS | WS_CLIPCHILDREN;
+            update_window_shared( desktop->top_window );
         }
     }
 
@@ -2179,6 +2232,7 @@ DECL_HANDLER(get_desktop_window)
         {
             detach_window_thread( desktop->msg_window );
             desktop->msg_window->style = WS_POPUP | WS_CLIPSIBLINGS | WS_CLIPCHILDREN;
+            update_window_shared( desktop->msg_window );
         }
     }
 
@@ -2214,6 +2268,7 @@ DECL_HANDLER(set_window_owner)
 
     reply->prev_owner = win->owner;
     reply->full_owner = win->owner = owner ? owner->handle : 0;
+    update_window_shared( win );
 }
 
 
@@ -2285,6 +2340,7 @@ DECL_HANDLER(set_window_info)
     if (req->flags & SET_WIN_USERDATA) win->user_data = req->user_data;
     if (req->flags & SET_WIN_EXTRA) memcpy( win->extra_bytes + req->extra_offset,
                                             &req->extra_value, req->extra_size );
+    if (req->flags & (SET_WIN_STYLE | SET_WIN_EXSTYLE | SET_WIN_ID)) update_window_shared( win );
 
     /* changing window style triggers a non-client paint */
     if (req->flags & SET_WIN_STYLE) win->paint_flags |= PAINT_NONCLIENT;